@@ -155,6 +155,12 @@ namespace edn
         }
         stringContent += *it;
       }
+      else if (token.length() > 1 && token[0] == ':' &&
+               ((*it == '[' && token.back() != '[') || (*it == ']' && std::count(token.begin(), token.end(), '[') > std::count(token.begin(), token.end(), ']'))))
+      {
+        // Brackets right after a keyword are part of it, the array and slice types :int32[1024] and :int32[]
+        token += *it;
+      }
       else if (*it == '(' || *it == ')' || *it == '[' || *it == ']' || *it == '{' ||
                *it == '}' || *it == '\t' || *it == '\n' || *it == '\r' || *it == ' ' || *it == ',')
       {
@@ -230,7 +236,23 @@ namespace edn
 
   bool validKeyword(string value)
   {
-    return (value[0] == ':' && validSymbol(value.substr(1, value.length() - 1)));
+    // Array and slice suffixes: [digits] or [], each after the name (:int32[4][], :int8[16]*)
+    string name = "";
+    for (string::iterator it = value.begin(); it != value.end(); ++it)
+    {
+      if (*it == '[')
+      {
+        string::iterator close = std::find(it, value.end(), ']');
+        if (close == value.end() || std::strspn(string(it + 1, close).c_str(), "0123456789") != size_t(close - it - 1))
+          return false;
+        it = close;
+      }
+      else if (*it == ']')
+        return false;
+      else
+        name += *it;
+    }
+    return (name[0] == ':' && validSymbol(name.substr(1, name.length() - 1)));
   }
 
   bool validNil(string value)
@@ -543,10 +565,8 @@ namespace edn
     return output;
   }
 
-  EdnNode read(string edn)
+  EdnNode parse(list<EdnToken> tokens)
   {
-    list<EdnToken> tokens = lex(edn);
-
     if (tokens.size() == 0)
     {
       throw "No parsable tokens found in string";
@@ -555,6 +575,11 @@ namespace edn
     return readAhead(shiftToken(tokens), tokens);
   }
 
+  EdnNode read(string edn)
+  {
+    return parse(lex(edn));
+  }
+
 }
 
 namespace edn {
@@ -52,6 +52,8 @@ namespace edn {
     std::string pprint();
   };
 
+  std::list<EdnToken> lex(std::string edn);
+  EdnNode parse(std::list<EdnToken> tokens);
   EdnNode read(std::string edn);
   std::string pprint(EdnNode &node, int indent = 1, bool multiline = true);
 }
\ No newline at end of file
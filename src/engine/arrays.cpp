@@ -0,0 +1,244 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <cstdlib>
+#include <fmt/format.h>
+#include <llvm/IR/Intrinsics.h>
+
+// Arrays and slices
+//
+// An array (:int32[1024]) is a local whose elements sit next to each other in
+// one entry block alloca. It is never loaded as a whole: the variable stands
+// for its address, (at a i) and (set-at a i v) address single elements, and
+// passing it where a slice (:int32[]) is expected makes a { data, length } view
+// of it. Slices are plain values and can be passed to and returned from defns.
+//
+// Every access checks its index and exits with the form's location when it is
+// out of range. The check is an unsigned compare against the length, which the
+// loop passes remove when the index provably stays in range (i from 0 below
+// (len a)). --unchecked leaves the checks out, so the accesses are bare
+// inbounds GEPs the optimizer is free to hoist and vectorize. In emitted asm and
+// obj, which outlive the engine, a failed check traps instead.
+//
+// An array literal ([1 2 3]) is a constant global. Indexing it reads the global
+// directly; assigning it to an array variable copies it in with one memcpy.
+
+// (= a :T[N] value): a copy of another T[N], or value converted to T and stored
+// into every element. Evaluates to the array's address like the variable does.
+llvm::Value* Engine::codegenAssignArray(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenAssignArray", [&] { return traceDetail(node); });
+    const edn::EdnNode& targetNode = *std::next(node.values.begin());
+    const edn::EdnNode& typeNode = *std::next(node.values.begin(), 2);
+    const edn::EdnNode& valueNode = node.values.back();
+    TypeRef type = resolveType(typeNode, typeNode.value.substr(1));
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    llvm::Value* array = nullptr;
+    if (SymbolTable::Symbol* symbol = symbols.lookup(targetNode.value)) {
+        array = symbol->value;
+    } else {
+        array = createEntryAlloca(builder, type->llvmType, targetNode.value);
+        symbols.declare(targetNode.value, array, type);
+    }
+    storeArray(valueNode, type, array, value, builder);
+    return array;
+}
+
+// Stores value, of valueNode's type, into all of array: memcpy for another
+// array, memset for zero, otherwise a loop over the elements
+void Engine::storeArray(const edn::EdnNode& valueNode, TypeRef type, llvm::Value* array, llvm::Value* value, llvm::IRBuilder<>& builder) {
+    TypeRef valueType = typeOf(valueNode);
+    llvm::MaybeAlign alignment(type->alignment);
+    if (valueType == type) {
+        if (value != array) {
+            builder.CreateMemCpy(array, alignment, value, alignment, type->size);
+        }
+        return;
+    }
+    llvm::Value* element = convertValue(valueNode, value, valueType, type->element, builder);
+    if (auto constant = llvm::dyn_cast<llvm::Constant>(element); constant && constant->isNullValue()) {
+        builder.CreateMemSet(array, builder.getInt8(0), type->size, alignment);
+        return;
+    }
+    // for (i 0 N) (set-at a i element), without the checks
+    llvm::LLVMContext& context = builder.getContext();
+    llvm::Function* function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock* preheaderBB = builder.GetInsertBlock();
+    llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(context, "fill.loop", function);
+    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(context, "fill.after", function);
+    auto [data, length] = arrayData(type, array, builder);
+    builder.CreateBr(loopBB);
+    builder.SetInsertPoint(loopBB);
+    llvm::PHINode* index = builder.CreatePHI(builder.getInt64Ty(), 2, "fill.i");
+    index->addIncoming(builder.getInt64(0), preheaderBB);
+    builder.CreateStore(element, builder.CreateInBoundsGEP(type->element->llvmType, data, index));
+    llvm::Value* next = builder.CreateNUWAdd(index, builder.getInt64(1), "fill.next");
+    index->addIncoming(next, loopBB);
+    builder.CreateCondBr(builder.CreateICmpULT(next, length), loopBB, afterBB);
+    builder.SetInsertPoint(afterBB);
+}
+
+// (at a i)
+llvm::Value* Engine::codegenAt(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenAt", [&] { return traceDetail(node); });
+    llvm::Value* address = elementAddress(node, context, builder);
+    return builder.CreateLoad(typeOf(node)->llvmType, address, "at");
+}
+
+// (set-at a i v)
+llvm::Value* Engine::codegenSetAt(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenSetAt", [&] { return traceDetail(node); });
+    llvm::Value* address = elementAddress(node, context, builder);
+    const edn::EdnNode& valueNode = node.values.back();
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    value = convertValue(valueNode, value, typeOf(valueNode), typeOf(node), builder);
+    builder.CreateStore(value, address);
+    return value;
+}
+
+// (len a)
+llvm::Value* Engine::codegenLen(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    const edn::EdnNode& targetNode = node.values.back();
+    TypeRef type = typeOf(targetNode);
+    if (type->isArray()) return builder.getInt64(type->length);
+    return builder.CreateExtractValue(this->codegenExpr(targetNode, context, builder), 1, "len");
+}
+
+// (slice a start end): checked as start <= end <= length
+llvm::Value* Engine::codegenSlice(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenSlice", [&] { return traceDetail(node); });
+    const edn::EdnNode& targetNode = *std::next(node.values.begin());
+    const edn::EdnNode& startNode = *std::next(node.values.begin(), 2);
+    const edn::EdnNode& endNode = node.values.back();
+    TypeRef type = typeOf(targetNode);
+    TypeRef int64Type = resolveType(node, "int64");
+    llvm::Value* target = this->codegenExpr(targetNode, context, builder);
+    auto [data, length] = arrayData(type, type->isArray() ? writableArray(type, target, builder) : target, builder);
+    llvm::Value* start = convertValue(startNode, this->codegenExpr(startNode, context, builder), typeOf(startNode), int64Type, builder);
+    llvm::Value* end = convertValue(endNode, this->codegenExpr(endNode, context, builder), typeOf(endNode), int64Type, builder);
+    if (options.boundsChecks) {
+        llvm::Value* inBounds = builder.CreateAnd(builder.CreateICmpULE(start, end), builder.CreateICmpULE(end, length), "inbounds");
+        emitBoundsCheck(node, inBounds, "yeet_slice_fail", {start, end, length}, builder);
+    }
+    TypeRef sliceType = typeOf(node);
+    llvm::Value* slice = builder.CreateInsertValue(llvm::UndefValue::get(sliceType->llvmType),
+        builder.CreateInBoundsGEP(type->element->llvmType, data, start), 0);
+    return builder.CreateInsertValue(slice, builder.CreateSub(end, start), 1, "slice");
+}
+
+// [1 2 3]: a private constant global holding the elements, so a lookup table
+// is data in the JIT's read-only memory rather than stores run on every call.
+// unnamed_addr lets the optimizer merge equal literals.
+llvm::Value* Engine::codegenArrayLiteral(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenArrayLiteral", [&] { return traceDetail(node); });
+    TypeRef type = typeOf(node);
+    std::vector<llvm::Constant*> elements;
+    for (const auto& valueNode : node.values) {
+        llvm::Value* value = convertValue(valueNode, this->codegenExpr(valueNode, context, builder), typeOf(valueNode), type->element, builder);
+        elements.push_back(llvm::cast<llvm::Constant>(value));
+    }
+    auto arrayType = llvm::cast<llvm::ArrayType>(type->llvmType);
+    auto global = new llvm::GlobalVariable(*builder.GetInsertBlock()->getModule(), arrayType, true,
+        llvm::GlobalValue::PrivateLinkage, llvm::ConstantArray::get(arrayType, elements), "array");
+    global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    global->setAlignment(llvm::Align(type->alignment));
+    return global;
+}
+
+// A slice can be stored through, so one of an array literal views a stack
+// copy of it. The copy goes away again when nothing stores into it.
+llvm::Value* Engine::writableArray(TypeRef type, llvm::Value* array, llvm::IRBuilder<>& builder) {
+    auto global = llvm::dyn_cast<llvm::GlobalVariable>(array);
+    if (!global || !global->isConstant()) return array;
+    llvm::AllocaInst* copy = createEntryAlloca(builder, type->llvmType, "array.copy");
+    llvm::MaybeAlign alignment(type->alignment);
+    builder.CreateMemCpy(copy, alignment, global, alignment, type->size);
+    return copy;
+}
+
+// Address of element i of (at a i ...) / (set-at a i ...), past its bounds check
+llvm::Value* Engine::elementAddress(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    const edn::EdnNode& targetNode = *std::next(node.values.begin());
+    const edn::EdnNode& indexNode = *std::next(node.values.begin(), 2);
+    TypeRef type = typeOf(targetNode);
+    auto [data, length] = arrayData(type, this->codegenExpr(targetNode, context, builder), builder);
+    llvm::Value* index = this->codegenExpr(indexNode, context, builder);
+    index = convertValue(indexNode, index, typeOf(indexNode), resolveType(indexNode, "int64"), builder);
+    if (options.boundsChecks) {
+        // Unsigned, so a negative index is out of range too
+        emitBoundsCheck(node, builder.CreateICmpULT(index, length, "inbounds"), "yeet_index_fail", {index, length}, builder);
+    }
+    return builder.CreateInBoundsGEP(type->element->llvmType, data, index, "elementptr");
+}
+
+// Pointer to the first element and the number of elements: from an array's
+// address, or out of a slice value
+std::pair<llvm::Value*, llvm::Value*> Engine::arrayData(TypeRef type, llvm::Value* value, llvm::IRBuilder<>& builder) {
+    if (type->isArray()) {
+        return {builder.CreateConstInBoundsGEP2_64(type->llvmType, value, 0, 0, "data"), builder.getInt64(type->length)};
+    }
+    return {builder.CreateExtractValue(value, 0, "data"), builder.CreateExtractValue(value, 1, "length")};
+}
+
+// Continues in a new block when inBounds holds, otherwise calls the host's
+// failure function with the form's location and values. The failure function
+// is cold and does not return, so the check costs a compare and a branch the
+// optimizer lays out as never taken.
+void Engine::emitBoundsCheck(const edn::EdnNode& node, llvm::Value* inBounds, const char* failure, const std::vector<llvm::Value*>& values, llvm::IRBuilder<>& builder) {
+    llvm::Function* function = builder.GetInsertBlock()->getParent();
+    llvm::Module& module = *function->getParent();
+    llvm::LLVMContext& context = module.getContext();
+    llvm::BasicBlock* okBB = llvm::BasicBlock::Create(context, "bounds.ok", function);
+    llvm::BasicBlock* failBB = llvm::BasicBlock::Create(context, "bounds.fail", function);
+    builder.CreateCondBr(inBounds, okBB, failBB);
+
+    builder.SetInsertPoint(failBB);
+    std::vector<llvm::Type*> paramTypes = {builder.getPtrTy(), builder.getInt32Ty(), builder.getInt32Ty()};
+    std::vector<llvm::Value*> args = {
+        llvm::ConstantExpr::getIntToPtr(builder.getInt64(reinterpret_cast<uint64_t>(this)), builder.getPtrTy()),
+        builder.getInt32(node.line), builder.getInt32(node.column)};
+    for (llvm::Value* value : values) {
+        paramTypes.push_back(value->getType());
+        args.push_back(value);
+    }
+    llvm::FunctionCallee failureFn = module.getOrInsertFunction(failure, llvm::FunctionType::get(builder.getVoidTy(), paramTypes, false));
+    if (auto declaration = llvm::dyn_cast<llvm::Function>(failureFn.getCallee())) {
+        declaration->setDoesNotReturn();
+        declaration->setDoesNotThrow();
+        declaration->addFnAttr(llvm::Attribute::Cold);
+    }
+    builder.CreateCall(failureFn, args);
+    builder.CreateUnreachable();
+
+    builder.SetInsertPoint(okBB);
+}
+
+// The failure functions are host symbols taking this engine's address, neither
+// exists once an emitted object is linked elsewhere. The artifact's copy of the
+// module traps in their place, before the unreachable that already follows.
+void Engine::trapBoundsFailures(llvm::Module& module) {
+    llvm::Function* trap = llvm::Intrinsic::getDeclaration(&module, llvm::Intrinsic::trap);
+    for (const char* failure : {"yeet_index_fail", "yeet_slice_fail"}) {
+        llvm::Function* declaration = module.getFunction(failure);
+        if (!declaration) continue;
+        while (!declaration->use_empty()) {
+            auto call = llvm::cast<llvm::CallInst>(declaration->user_back());
+            llvm::CallInst::Create(trap, {}, "", call);
+            call->eraseFromParent();
+        }
+        declaration->eraseFromParent();
+    }
+}
+
+void Engine::indexFailureTrampoline(Engine* engine, int32_t line, int32_t column, int64_t index, int64_t length)
+{
+    std::cout.flush();
+    std::cerr << fmt::format("{}({},{}) : error: index {} out of bounds for length {}", engine->filePath, line, column, index, length) << std::endl;
+    std::exit(1);
+}
+
+void Engine::sliceFailureTrampoline(Engine* engine, int32_t line, int32_t column, int64_t start, int64_t end, int64_t length)
+{
+    std::cout.flush();
+    std::cerr << fmt::format("{}({},{}) : error: slice [{}, {}) out of bounds for length {}", engine->filePath, line, column, start, end, length) << std::endl;
+    std::exit(1);
+}
@@ -0,0 +1,591 @@
+#include "engine.hpp"
+#include "astopt.hpp"
+
+using namespace yeet;
+#include <cmath>
+#include <fmt/format.h>
+
+namespace {
+    using edn::EdnNode;
+
+    bool isOp(const EdnNode& node, const char* op)
+    {
+        return node.type == edn::EdnList && !node.values.empty() && node.values.front().type == edn::EdnSymbol && node.values.front().value == op;
+    }
+
+    // Only binary operators get an operandType from the checker
+    bool isBinop(const EdnNode& node)
+    {
+        return node.type == edn::EdnList && node.metadata.count("operandType");
+    }
+
+    bool isSequence(const EdnNode& node)
+    {
+        return node.type == edn::EdnList && node.metadata.count("sequence");
+    }
+
+    bool isLiteral(const EdnNode& node)
+    {
+        return node.type == edn::EdnInt || node.type == edn::EdnFloat || node.type == edn::EdnBool;
+    }
+
+    bool isComparison(const std::string& op)
+    {
+        return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+    }
+
+    // (= x (StructName (fields...)))
+    bool isStructConstruct(const EdnNode& node)
+    {
+        return isOp(node, "=") && node.values.size() == 3 && std::next(node.values.begin())->type == edn::EdnSymbol;
+    }
+
+    // Target symbol of (= x :type value) and (= x (StructName (...))), nullptr for anything else
+    const EdnNode* assignTarget(const EdnNode& node)
+    {
+        if (!isOp(node, "=") || (node.values.size() != 3 && node.values.size() != 4)) return nullptr;
+        const EdnNode& target = *std::next(node.values.begin());
+        return target.type == edn::EdnSymbol ? &target : nullptr;
+    }
+
+    // No side effects: dropping or reordering it cannot be observed
+    bool isPure(const EdnNode& node)
+    {
+        switch (node.type) {
+            case edn::EdnInt:
+            case edn::EdnFloat:
+            case edn::EdnBool:
+            case edn::EdnSymbol:
+            case edn::EdnVector:
+                return true;
+            case edn::EdnList:
+                break;
+            default:
+                return false;
+        }
+        if (isOp(node, ".") || isOp(node, "ref")) return true;
+        // Vector builtins: only the operands that have a type are evaluated, not
+        // splat's type, reduce's operator or shuffle's mask
+        if (isOp(node, "splat") || isOp(node, "extract") || isOp(node, "insert") || isOp(node, "shuffle") || isOp(node, "reduce")) {
+            for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+                if (it->metadata.count("type") && !isPure(*it)) return false;
+            }
+            return true;
+        }
+        if (isSequence(node) || isBinop(node) || isOp(node, "deref") || isOp(node, "cond") || isOp(node, "select")) {
+            auto first = isSequence(node) ? node.values.begin() : std::next(node.values.begin());
+            for (auto it = first; it != node.values.end(); ++it) {
+                if (isOp(node, "cond")) {
+                    for (const auto& part : it->values) {
+                        if (!isPure(part)) return false;
+                    }
+                } else if (!isPure(*it)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Literals, variables and binary operators over them
+    bool isArithmetic(const EdnNode& node)
+    {
+        if (isLiteral(node)) return true;
+        if (node.type == edn::EdnSymbol) return node.value != "else";
+        if (!isBinop(node)) return false;
+        for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+            if (!isArithmetic(*it)) return false;
+        }
+        return true;
+    }
+
+    // Structural key of an arithmetic expression, types included
+    std::string exprKey(const EdnNode& node)
+    {
+        if (node.type != edn::EdnList) {
+            return fmt::format("{}:{}", node.value, nodeType(node));
+        }
+        std::string key = "(" + node.values.front().value;
+        for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+            key += " " + exprKey(*it);
+        }
+        return key + "):" + nodeType(node);
+    }
+
+    void collectSymbols(const EdnNode& node, std::set<std::string>& symbols)
+    {
+        if (node.type == edn::EdnSymbol) {
+            symbols.insert(node.value);
+        }
+        for (const auto& child : node.values) {
+            collectSymbols(child, symbols);
+        }
+    }
+
+    // Whether the expression binds a variable of its own (outside nested defns)
+    bool declaresVariables(const EdnNode& node)
+    {
+        if (node.type != edn::EdnList || isOp(node, "defn")) return false;
+        if (assignTarget(node)) return true;
+        for (const auto& child : node.values) {
+            if (declaresVariables(child)) return true;
+        }
+        return false;
+    }
+
+    bool containsNode(const EdnNode& root, const EdnNode* target)
+    {
+        if (&root == target) return true;
+        for (const auto& child : root.values) {
+            if (containsNode(child, target)) return true;
+        }
+        return false;
+    }
+
+    EdnNode makeNode(edn::NodeType type, const std::string& value, const std::string& nodeTypeStr, const EdnNode& at)
+    {
+        EdnNode node;
+        node.type = type;
+        node.line = at.line;
+        node.column = at.column;
+        node.value = value;
+        if (!nodeTypeStr.empty()) {
+            node.metadata["type"] = nodeTypeStr;
+        }
+        return node;
+    }
+
+    // A literal's value as the operator sees it
+    struct Constant {
+        bool isFloat = false;
+        long long integer = 0;
+        double real = 0.0;
+    };
+
+    bool literalConstant(const EdnNode& node, Constant& constant)
+    {
+        try {
+            switch (node.type) {
+                case edn::EdnBool: constant.integer = node.value == "true"; return true;
+                case edn::EdnInt: constant.integer = std::stoll(node.value); return true;
+                case edn::EdnFloat: constant.isFloat = true; constant.real = std::stod(node.value); return true;
+                default: return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool isTruthy(const Constant& constant)
+    {
+        return constant.isFloat ? (constant.real != 0.0 && !std::isnan(constant.real)) : constant.integer != 0;
+    }
+
+    // Two's complement wrap to the given width, the way the LLVM integer ops behave
+    long long wrapInteger(unsigned long long value, unsigned bits)
+    {
+        if (bits >= 64) return static_cast<long long>(value);
+        unsigned long long mask = (1ULL << bits) - 1;
+        value &= mask;
+        if (value >> (bits - 1)) value |= ~mask;
+        return static_cast<long long>(value);
+    }
+
+    // Same conversions as Engine::convertValue; false where LLVM would produce poison.
+    // from is taken by value so a constant can be converted in place
+    bool convertConstant(Constant from, const std::string& fromType, const std::string& toType, Constant& to)
+    {
+        if (isFloatType(toType)) {
+            to.isFloat = true;
+            to.real = from.isFloat ? from.real : static_cast<double>(fromType == "bool" ? (from.integer & 1) : from.integer);
+            if (toType == "float32") to.real = static_cast<float>(to.real);
+            return true;
+        }
+        to.isFloat = false;
+        if (toType == "bool") {
+            to.integer = isTruthy(from);
+            return true;
+        }
+        unsigned bits = integerBitWidth(toType);
+        if (from.isFloat) {
+            double truncated = std::trunc(from.real);
+            double limit = std::ldexp(1.0, bits - 1);
+            if (!(truncated >= -limit && truncated < limit)) return false;
+            to.integer = static_cast<long long>(truncated);
+            return true;
+        }
+        to.integer = fromType == "bool" ? (from.integer & 1) : wrapInteger(from.integer, bits);
+        return true;
+    }
+
+    bool compare(const std::string& op, auto lhs, auto rhs)
+    {
+        if (op == "==") return lhs == rhs;
+        if (op == "!=") return lhs != rhs;
+        if (op == "<") return lhs < rhs;
+        if (op == "<=") return lhs <= rhs;
+        if (op == ">") return lhs > rhs;
+        return lhs >= rhs;
+    }
+}
+
+void AstOptimizer::run(edn::EdnNode& root)
+{
+    globals.clear();
+    collectGlobals(root);
+    foldConstants(root);
+
+    // Dead code is judged per function: each defn body, then calc
+    std::vector<edn::EdnNode*> functions;
+    std::vector<edn::EdnNode*> pending = {&root};
+    while (!pending.empty()) {
+        edn::EdnNode* node = pending.back();
+        pending.pop_back();
+        if (isOp(*node, "defn")) functions.push_back(node);
+        for (auto& child : node->values) {
+            pending.push_back(&child);
+        }
+    }
+    // Innermost first, sweeping a scope may move the nodes of the ones it contains
+    for (auto it = functions.rbegin(); it != functions.rend(); ++it) {
+        eliminateDeadCode(**it);
+    }
+    eliminateDeadCode(root);
+
+    eliminateCommonSubexpressions(root);
+
+    // Folding and dead code removal can change what a block ends in
+    std::vector<edn::EdnNode*> postOrder;
+    pending = {&root};
+    while (!pending.empty()) {
+        edn::EdnNode* node = pending.back();
+        pending.pop_back();
+        postOrder.push_back(node);
+        for (auto& child : node->values) {
+            pending.push_back(&child);
+        }
+    }
+    for (auto it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+        if (isSequence(**it)) {
+            (*it)->metadata["type"] = nodeType((*it)->values.back());
+        }
+    }
+}
+
+// Names bound by def and const, which only appear at the top level
+void AstOptimizer::collectGlobals(const edn::EdnNode& node)
+{
+    if (isOp(node, "def") || isOp(node, "const")) {
+        globals.insert(std::next(node.values.begin())->value);
+    } else if (isSequence(node)) {
+        for (const auto& statement : node.values) {
+            collectGlobals(statement);
+        }
+    }
+}
+
+void AstOptimizer::foldConstants(edn::EdnNode& node)
+{
+    if (node.type != edn::EdnList) return;
+    for (auto& child : node.values) {
+        foldConstants(child);
+    }
+    if (isBinop(node)) {
+        foldBinop(node);
+    } else if (isOp(node, "cond")) {
+        foldCond(node);
+    } else if (isOp(node, "select")) {
+        foldSelect(node);
+    } else if (isOp(node, "while")) {
+        foldWhile(node);
+    }
+}
+
+// (op literal literal) -> literal of the operator's result type
+bool AstOptimizer::foldBinop(edn::EdnNode& node)
+{
+    const std::string op = node.values.front().value;
+    const std::string operandType = node.metadata.at("operandType");
+    const std::string resultType = nodeType(node);
+    const edn::EdnNode& lhsNode = *std::next(node.values.begin());
+    const edn::EdnNode& rhsNode = *std::next(node.values.begin(), 2);
+    Constant lhs, rhs;
+    if (!literalConstant(lhsNode, lhs) || !literalConstant(rhsNode, rhs)) return false;
+    if (!convertConstant(lhs, nodeType(lhsNode), operandType, lhs) || !convertConstant(rhs, nodeType(rhsNode), operandType, rhs)) return false;
+
+    edn::EdnNode folded;
+    if (isFloatType(operandType)) {
+        double a = lhs.real;
+        double b = rhs.real;
+        if (isComparison(op)) {
+            // Unordered comparisons, like the fcmp u* codegen emits
+            bool value = std::isnan(a) || std::isnan(b) || compare(op, a, b);
+            folded = makeNode(edn::EdnBool, value ? "true" : "false", resultType, node);
+        } else {
+            double value = op == "+" ? a + b : op == "-" ? a - b : op == "*" ? a * b : a / b;
+            if (operandType == "float32") value = static_cast<float>(value);
+            folded = makeNode(edn::EdnFloat, fmt::format("{}", value), resultType, node);
+        }
+    } else {
+        long long a = lhs.integer;
+        long long b = rhs.integer;
+        unsigned bits = integerBitWidth(operandType);
+        if (isComparison(op)) {
+            // i1 compares signed, true is -1
+            if (operandType == "bool" && op != "==" && op != "!=") return false;
+            folded = makeNode(edn::EdnBool, compare(op, a, b) ? "true" : "false", resultType, node);
+        } else {
+            long long value = 0;
+            auto ua = static_cast<unsigned long long>(a);
+            auto ub = static_cast<unsigned long long>(b);
+            if (op == "+") value = wrapInteger(ua + ub, bits);
+            else if (op == "-") value = wrapInteger(ua - ub, bits);
+            else if (op == "*") value = wrapInteger(ua * ub, bits);
+            else {
+                // Division by zero and MIN / -1 stay in the program
+                if (b == 0 || (b == -1 && a == wrapInteger(1ULL << (bits - 1), bits))) return false;
+                value = a / b;
+            }
+            folded = makeNode(edn::EdnInt, std::to_string(value), resultType, node);
+        }
+    }
+    node = std::move(folded);
+    return true;
+}
+
+// Drops clauses whose test is a constant false; a constant true test ends the cond.
+// When only the unconditional clause is left the cond is replaced by its expression.
+void AstOptimizer::foldCond(edn::EdnNode& node)
+{
+    for (auto it = std::next(node.values.begin()); it != node.values.end();) {
+        edn::EdnNode& clause = *it;
+        // The last clause is taken whatever its test says, see Engine::codegenCond
+        bool unconditional = clause.values.size() == 1 || std::next(it) == node.values.end() ||
+            (clause.values.front().type == edn::EdnSymbol && clause.values.front().value == "else");
+        Constant test;
+        if (!unconditional && literalConstant(clause.values.front(), test)) {
+            if (!isTruthy(test)) {
+                it = node.values.erase(it);
+                continue;
+            }
+            clause.values.front() = makeNode(edn::EdnSymbol, "else", "bool", clause.values.front());
+            unconditional = true;
+        }
+        if (unconditional) {
+            node.values.erase(std::next(it), node.values.end());
+            break;
+        }
+        ++it;
+    }
+    // An arm is its own scope, so one that binds variables keeps its cond
+    if (node.values.size() == 2 && !declaresVariables(node.values.back().values.back())) {
+        edn::EdnNode taken = std::move(node.values.back().values.back());
+        node = std::move(taken);
+    }
+}
+
+// A constant test picks its value, as long as the one not picked has no side effects
+void AstOptimizer::foldSelect(edn::EdnNode& node)
+{
+    Constant test;
+    if (node.values.size() != 4 || !literalConstant(*std::next(node.values.begin()), test)) return;
+    auto taken = std::next(node.values.begin(), isTruthy(test) ? 2 : 3);
+    auto dropped = std::next(node.values.begin(), isTruthy(test) ? 3 : 2);
+    if (!isPure(*dropped)) return;
+    edn::EdnNode value = std::move(*taken);
+    node = std::move(value);
+}
+
+// A loop whose test is constant false never runs. It is left as its own false
+// test, still typed void, which dead code removal drops as a statement.
+void AstOptimizer::foldWhile(edn::EdnNode& node)
+{
+    Constant test;
+    if (literalConstant(*std::next(node.values.begin()), test) && !isTruthy(test)) {
+        node = makeNode(edn::EdnBool, "false", nodeType(node), node);
+    }
+}
+
+void AstOptimizer::eliminateDeadCode(edn::EdnNode& scopeRoot)
+{
+    bool isFunction = isOp(scopeRoot, "defn");
+    auto bodyBegin = isFunction ? std::next(scopeRoot.values.begin(), 4) : scopeRoot.values.begin();
+    // Removing one assignment can leave the variables it read unused
+    bool changed = true;
+    while (changed) {
+        std::unordered_map<std::string, size_t> reads;
+        changed = false;
+        // Any function may read a global, whatever this one does
+        for (const auto& name : globals) {
+            ++reads[name];
+        }
+        if (isFunction) {
+            for (auto it = bodyBegin; it != scopeRoot.values.end(); ++it) {
+                countReads(*it, reads);
+            }
+            changed |= sweepBlock(scopeRoot.values, bodyBegin, reads);
+            for (auto it = bodyBegin; it != scopeRoot.values.end(); ++it) {
+                changed |= sweepBlocks(*it, reads);
+            }
+        } else {
+            countReads(scopeRoot, reads);
+            changed |= sweepBlocks(scopeRoot, reads);
+        }
+    }
+}
+
+// Every use of a variable other than as an assignment target; defn bodies are their own scope
+void AstOptimizer::countReads(const edn::EdnNode& node, std::unordered_map<std::string, size_t>& reads) const
+{
+    if (node.type == edn::EdnSymbol) {
+        ++reads[node.value];
+        return;
+    }
+    if (node.type != edn::EdnList || isOp(node, "defn") || isOp(node, "struct")) return;
+    const edn::EdnNode* target = assignTarget(node);
+    for (const auto& child : node.values) {
+        if (&child != target) {
+            countReads(child, reads);
+        }
+    }
+}
+
+bool AstOptimizer::sweepBlocks(edn::EdnNode& node, const std::unordered_map<std::string, size_t>& reads)
+{
+    if (node.type != edn::EdnList || isOp(node, "defn")) return false;
+    bool changed = false;
+    if (isSequence(node)) {
+        changed |= sweepBlock(node.values, node.values.begin(), reads);
+    }
+    for (auto& child : node.values) {
+        changed |= sweepBlocks(child, reads);
+    }
+    // A block down to one expression is that expression
+    if (isSequence(node) && node.values.size() == 1) {
+        edn::EdnNode only = std::move(node.values.front());
+        node = std::move(only);
+        changed = true;
+    }
+    return changed;
+}
+
+// The last statement is the block's value and always stays
+bool AstOptimizer::sweepBlock(NodeList& statements, NodeList::iterator begin, const std::unordered_map<std::string, size_t>& reads)
+{
+    bool changed = false;
+    for (auto it = begin; it != statements.end() && std::next(it) != statements.end();) {
+        edn::EdnNode& statement = *it;
+        if (isPure(statement)) {
+            it = statements.erase(it);
+            changed = true;
+            continue;
+        }
+        const edn::EdnNode* target = assignTarget(statement);
+        if (target && !reads.count(target->value)) {
+            if (isStructConstruct(statement)) {
+                const edn::EdnNode& fields = statement.values.back().values.back();
+                if (std::all_of(fields.values.begin(), fields.values.end(), isPure)) {
+                    it = statements.erase(it);
+                    changed = true;
+                    continue;
+                }
+            } else if (isPure(statement.values.back())) {
+                it = statements.erase(it);
+                changed = true;
+                continue;
+            } else {
+                // Keep the side effects, drop the store
+                edn::EdnNode value = std::move(statement.values.back());
+                statement = std::move(value);
+                changed = true;
+            }
+        }
+        ++it;
+    }
+    return changed;
+}
+
+void AstOptimizer::eliminateCommonSubexpressions(edn::EdnNode& node)
+{
+    if (node.type != edn::EdnList) return;
+    if (isOp(node, "defn")) {
+        cseBlock(node.values, std::next(node.values.begin(), 4));
+        return;
+    }
+    if (isSequence(node)) {
+        cseBlock(node.values, node.values.begin());
+        return;
+    }
+    for (auto& child : node.values) {
+        eliminateCommonSubexpressions(child);
+    }
+}
+
+// Straight-line statements: (= x :type arithmetic) and bare arithmetic. Anything
+// else (calls, put, control flow) may write memory or skip code, so it ends
+// what is known and only its nested blocks are processed.
+void AstOptimizer::cseBlock(NodeList& statements, NodeList::iterator begin)
+{
+    available.clear();
+    for (auto it = begin; it != statements.end(); ++it) {
+        edn::EdnNode& statement = *it;
+        const edn::EdnNode* target = assignTarget(statement);
+        if (target && statement.values.size() == 4 && isArithmetic(statement.values.back())) {
+            cseVisit(statements, it, statement.values, std::prev(statement.values.end()));
+            std::string assigned = target->value;
+            std::erase_if(available, [&](const auto& entry) { return entry.second.symbols.count(assigned) > 0; });
+        } else if (!target && isArithmetic(statement)) {
+            cseVisit(statements, it, statements, it);
+        } else {
+            available.clear();
+            eliminateCommonSubexpressions(statement);
+            available.clear();
+        }
+    }
+    available.clear();
+}
+
+// Keys are taken before the children are rewritten, so a match always means
+// the same expression over the same, unchanged variables
+void AstOptimizer::cseVisit(NodeList& block, NodeList::iterator statement, NodeList& parent, NodeList::iterator position)
+{
+    edn::EdnNode& node = *position;
+    if (!isBinop(node)) return;
+    std::string key = exprKey(node);
+    auto found = available.find(key);
+    if (found != available.end()) {
+        Available& entry = found->second;
+        std::string type = nodeType(node);
+        if (entry.tempName.empty()) {
+            // First reuse: move the first occurrence into (= __cseN :type expr) just before its statement
+            entry.tempName = fmt::format("__cse{}", tempCount++);
+            const edn::EdnNode& first = *entry.position;
+            auto assign = entry.block->insert(entry.statement, makeNode(edn::EdnList, "", type, first));
+            assign->values.push_back(makeNode(edn::EdnSymbol, "=", "", first));
+            assign->values.push_back(makeNode(edn::EdnSymbol, entry.tempName, type, first));
+            assign->values.push_back(makeNode(edn::EdnKeyword, ":" + type, "", first));
+            auto after = std::next(entry.position);
+            assign->values.splice(assign->values.end(), *entry.parent, entry.position);
+            entry.parent->insert(after, makeNode(edn::EdnSymbol, entry.tempName, type, assign->values.back()));
+            // Subexpressions that moved along are now computed by the new assignment
+            for (auto& [otherKey, other] : available) {
+                if (other.statement == entry.statement && containsNode(assign->values.back(), &*other.position)) {
+                    other.statement = assign;
+                }
+            }
+            entry.parent = &assign->values;
+            entry.position = std::prev(assign->values.end());
+        }
+        node = makeNode(edn::EdnSymbol, entry.tempName, type, node);
+        return;
+    }
+    for (auto child = std::next(node.values.begin()); child != node.values.end(); ++child) {
+        cseVisit(block, statement, node.values, child);
+    }
+    // A whole statement is only ever replaced, never moved out from under cseBlock
+    if (&parent == &block) return;
+    Available entry{&block, statement, &parent, position, {}, ""};
+    collectSymbols(node, entry.symbols);
+    available.emplace(key, std::move(entry));
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "edn/edn.hpp"
+
+namespace yeet
+{
+    // Yeet level simplifications on the type checked tree, run before codegen
+    // so trivial work never reaches LLVM:
+    //   - constant folding of binary operators whose operands are literals
+    //   - cond clauses, selects and while loops whose test is a constant
+    //   - pure statements whose value is unused and assignments to variables
+    //     that are never read
+    //   - common pure arithmetic within a straight-line block, computed once
+    //     into a __cse<N> temporary
+    // Every node it creates carries its resolved type like the checker's own.
+    class AstOptimizer
+    {
+    public:
+        void run(edn::EdnNode& root);
+
+    private:
+        using NodeList = std::list<edn::EdnNode>;
+
+        void collectGlobals(const edn::EdnNode& node);
+
+        // Constant folding
+        void foldConstants(edn::EdnNode& node);
+        bool foldBinop(edn::EdnNode& node);
+        void foldCond(edn::EdnNode& node);
+        void foldSelect(edn::EdnNode& node);
+        void foldWhile(edn::EdnNode& node);
+
+        // Dead code elimination, one scope (calc or a defn body) at a time. Stores
+        // to globals always stay.
+        void eliminateDeadCode(edn::EdnNode& scopeRoot);
+        void countReads(const edn::EdnNode& node, std::unordered_map<std::string, size_t>& reads) const;
+        bool sweepBlocks(edn::EdnNode& node, const std::unordered_map<std::string, size_t>& reads);
+        bool sweepBlock(NodeList& statements, NodeList::iterator begin, const std::unordered_map<std::string, size_t>& reads);
+
+        // Local common subexpression elimination
+        struct Available {
+            NodeList* block;
+            NodeList::iterator statement;
+            NodeList* parent;
+            NodeList::iterator position;
+            std::set<std::string> symbols;
+            std::string tempName;
+        };
+        void eliminateCommonSubexpressions(edn::EdnNode& node);
+        void cseBlock(NodeList& statements, NodeList::iterator begin);
+        void cseVisit(NodeList& block, NodeList::iterator statement, NodeList& parent, NodeList::iterator position);
+
+    private:
+        std::unordered_map<std::string, Available> available;
+        size_t tempCount = 0;
+        // def and const names, read by code DCE does not see
+        std::set<std::string> globals;
+    };
+}
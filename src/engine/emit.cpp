@@ -0,0 +1,82 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Target/TargetMachine.h>
+
+// Write the --emit artifact straight to its output stream.
+// A standalone module is a private copy taken before the JIT pipeline ran: it
+// still needs multiversioning and optimizing. Otherwise the module is exactly
+// what the JIT is about to run.
+void Engine::emitArtifact(llvm::Module& module, bool standalone)
+{
+    // Loadable artifacts: position independent, small code model (the JIT defaults differ)
+    llvm::orc::JITTargetMachineBuilder artifactBuilder = *targetBuilder;
+    artifactBuilder.setRelocationModel(llvm::Reloc::PIC_);
+    artifactBuilder.setCodeModel(llvm::CodeModel::Small);
+    if (!options.multiversion.empty()) {
+        artifactBuilder.setCPU(options.multiversion.front());
+        artifactBuilder.getFeatures() = llvm::SubtargetFeatures();
+    }
+    auto targetMachine = artifactBuilder.createTargetMachine();
+    if (!targetMachine) {
+        std::cerr << "Failed to create target machine: " << llvm::toString(targetMachine.takeError()) << std::endl;
+        return;
+    }
+
+    if (standalone) {
+        if (!options.multiversion.empty()) {
+            const llvm::Triple& triple = (*targetMachine)->getTargetTriple();
+            if (triple.getArch() != llvm::Triple::x86_64 || !triple.isOSBinFormatELF()) {
+                std::cerr << "--multiversion needs an x86-64 ELF target, not " << triple.str() << std::endl;
+                return;
+            }
+            multiversionFunctions(module, **targetMachine);
+        }
+        if (!options.tiered && options.optLevel > 0) {
+            optimizeModule(module, options.optLevel);
+        }
+    }
+
+    // Text goes to stdout unless -o says otherwise, binaries default to <input stem>.bc/.o
+    bool isText = options.emit == EmitKind::IR || options.emit == EmitKind::Assembly;
+    std::string path = options.outputPath;
+    if (path.empty()) {
+        if (isText) {
+            path = "-";
+        } else {
+            path = llvm::sys::path::stem(filePath).str() + (options.emit == EmitKind::Bitcode ? ".bc" : ".o");
+        }
+    }
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, isText ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+    if (ec) {
+        std::cerr << "Failed to open " << path << ": " << ec.message() << std::endl;
+        return;
+    }
+
+    switch (options.emit) {
+        case EmitKind::None:
+            return;
+        case EmitKind::IR:
+            module.print(out, nullptr);
+            return;
+        case EmitKind::Bitcode:
+            llvm::WriteBitcodeToFile(module, out);
+            return;
+        case EmitKind::Assembly:
+        case EmitKind::Object: {
+            llvm::legacy::PassManager codegenPasses;
+            auto fileType = options.emit == EmitKind::Assembly ? llvm::CodeGenFileType::AssemblyFile : llvm::CodeGenFileType::ObjectFile;
+            if ((*targetMachine)->addPassesToEmitFile(codegenPasses, out, nullptr, fileType)) {
+                std::cerr << "Target cannot emit this file type" << std::endl;
+                return;
+            }
+            codegenPasses.run(module);
+            return;
+        }
+    }
+}
@@ -1,36 +1,121 @@
 #include "engine.hpp"
 
 using namespace yeet;
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <unordered_set>
 #include <fmt/format.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include "astopt.hpp"
 #include "../edn/edn.hpp"
 
-// Helper: Map type string to LLVM type
-llvm::Type* Engine::getLLVMType(const edn::EdnNode& node, const std::string& typeStr, llvm::IRBuilder<>& builder) {
-    // Pointer type support: if typeStr ends with '*', treat as pointer to base type
-    if (!typeStr.empty() && typeStr.back() == '*') {
-        std::string baseTypeStr = typeStr.substr(0, typeStr.size() - 1);
-        llvm::Type* baseType = getLLVMType(node, baseTypeStr, builder);
-        // Address space 0 for default
-        return llvm::PointerType::get(baseType, 0);
-    }
-    if (typeStr == "int8") return builder.getInt8Ty();
-    if (typeStr == "int16") return builder.getInt16Ty();
-    if (typeStr == "int32") return builder.getInt32Ty();
-    if (typeStr == "int64") return builder.getInt64Ty();
-    if (typeStr == "float32") return llvm::Type::getFloatTy(builder.getContext());
-    if (typeStr == "float64") return builder.getDoubleTy();
-    if (typeStr == "void") return builder.getVoidTy();
-    throw YeetCompileException(node, fmt::format("Unknown type string for LLVM type: {}", typeStr), filePath, __FILE__, __LINE__);
+// Helper: Map type string to its interned type
+TypeRef Engine::resolveType(const edn::EdnNode& node, const std::string& typeStr) {
+    TypeRef type = types->lookup(typeStr);
+    if (!type) throw YeetCompileException(node, fmt::format("Unknown type string for LLVM type: {}", typeStr), filePath, __FILE__, __LINE__);
+    return type;
+}
+
+TypeRef Engine::typeOf(const edn::EdnNode& node) {
+    return resolveType(node, nodeType(node));
 }
 
+// Implicit numeric conversion between two type checker types; bool widens as 0/1 and narrows as != 0.
+// A scalar converted to a vector is converted to the lane type and splat.
+llvm::Value* Engine::convertValue(const edn::EdnNode& node, llvm::Value* value, TypeRef fromType, TypeRef toType, llvm::IRBuilder<>& builder) {
+    if (fromType == toType) return value;
+    if (fromType->isPointer() && toType->isPointer()) return value;
+    if (fromType->isNumeric() && toType->isVector()) {
+        llvm::Value* lane = convertValue(node, value, fromType, toType->element, builder);
+        return builder.CreateVectorSplat(toType->lanes, lane, "splat");
+    }
+    if (fromType->isArray() && toType->isSlice() && fromType->element == toType->element) {
+        // value is the array's address
+        auto [data, length] = arrayData(fromType, writableArray(fromType, value, builder), builder);
+        llvm::Value* slice = builder.CreateInsertValue(llvm::UndefValue::get(toType->llvmType), data, 0);
+        return builder.CreateInsertValue(slice, length, 1, "slice");
+    }
+    if (!fromType->isNumeric() || !toType->isNumeric()) {
+        throw YeetCompileException(node, fmt::format("Cannot convert {} to {}", fromType->name, toType->name), filePath, __FILE__, __LINE__);
+    }
+    if (toType->isBool()) {
+        if (fromType->isFloat()) return builder.CreateFCmpONE(value, llvm::ConstantFP::get(value->getType(), 0.0), "tobool");
+        return builder.CreateICmpNE(value, llvm::ConstantInt::get(value->getType(), 0), "tobool");
+    }
+    llvm::Type* llvmType = toType->llvmType;
+    bool isSigned = !fromType->isBool();
+    if (fromType->isFloat() && toType->isFloat()) return builder.CreateFPCast(value, llvmType, "fpcast");
+    if (fromType->isFloat()) return builder.CreateFPToSI(value, llvmType, "fptosi");
+    if (toType->isFloat()) return isSigned ? builder.CreateSIToFP(value, llvmType, "sitofp") : builder.CreateUIToFP(value, llvmType, "uitofp");
+    return builder.CreateIntCast(value, llvmType, isSigned, "intcast");
+}
 
+// Stack slot for a local. Always placed with the other allocas at the top of the entry
+// block, so it is reserved once per call however often the code around it runs, and
+// mem2reg can promote it.
+llvm::AllocaInst* Engine::createEntryAlloca(llvm::IRBuilder<>& builder, llvm::Type* type, const std::string& name) {
+    llvm::BasicBlock& entry = builder.GetInsertBlock()->getParent()->getEntryBlock();
+    auto insertPoint = entry.begin();
+    while (insertPoint != entry.end() && llvm::isa<llvm::AllocaInst>(*insertPoint)) {
+        ++insertPoint;
+    }
+    llvm::IRBuilder<> entryBuilder(&entry, insertPoint);
+    return entryBuilder.CreateAlloca(type, nullptr, name);
+}
 
-Engine::Engine(const std::string& filePath_) : filePath(filePath_) {
+Engine::Engine(const std::string& filePath_, const EngineOptions& options_) : filePath(filePath_), options(options_) {
+    if (options.timeReport) {
+        phaseTimers = std::make_unique<llvm::TimerGroup>("yeet", "Compile phases");
+    }
+    if (!options.tracePath.empty()) {
+        llvm::timeTraceProfilerInitialize(options.traceGranularity, "yeet");
+    }
     initializeLLVM();
 }
 
 Engine::~Engine() {
-    // Cleanup if necessary
+    {
+        // Background tier-up compiles still reference the JIT
+        std::lock_guard<std::mutex> lock(tierMutex);
+        for (auto& thread : tierThreads) {
+            thread.join();
+        }
+    }
+    // Written last so the tier-up threads' spans are in the trace
+    if (llvm::timeTraceProfilerEnabled()) {
+        if (auto err = llvm::timeTraceProfilerWrite(options.tracePath, filePath)) {
+            std::cerr << "Failed to write trace: " << llvm::toString(std::move(err)) << std::endl;
+        }
+        llvm::timeTraceProfilerCleanup();
+    }
+}
+
+// A compile phase: one row in --time-report and one span in --trace
+class PhaseScope {
+public:
+    PhaseScope(llvm::Timer* timer, llvm::StringRef name) : traceScope(name), timeRegion(timer) {}
+private:
+    llvm::TimeTraceScope traceScope;
+    llvm::TimeRegion timeRegion;
+};
+
+// Timer of the named phase in the --time-report group, nullptr without --time-report
+llvm::Timer* Engine::phaseTimer(const std::string& name)
+{
+    if (!phaseTimers) return nullptr;
+    auto& timer = phaseTimerTable[name];
+    if (!timer) {
+        timer = std::make_unique<llvm::Timer>(name, name, *phaseTimers);
+    }
+    return timer.get();
 }
 
 void Engine::initializeLLVM()
@@ -39,25 +124,271 @@ void Engine::initializeLLVM()
     llvm::InitializeNativeTargetAsmPrinter();
     llvm::InitializeNativeTargetAsmParser();
 
-    jit = std::move(*llvm::orc::LLJITBuilder().create());
+    auto hostBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!hostBuilder) {
+        throw std::runtime_error("Failed to detect host target: " + llvm::toString(hostBuilder.takeError()));
+    }
+    targetBuilder = std::move(*hostBuilder);
+    if (!options.march.empty() && options.march != "native") {
+        // Only the features implied by the named CPU, not everything the host has
+        targetBuilder->setCPU(options.march);
+        targetBuilder->getFeatures() = llvm::SubtargetFeatures();
+    }
+    if (options.printTarget) {
+        printTargetInfo();
+    }
+
+    jit = std::move(*llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(*targetBuilder).create());
     context = std::make_unique<llvm::LLVMContext>();
+    if (options.remarks) {
+        enableRemarks(*context);
+    }
+    types = std::make_unique<TypeRegistry>(*context, jit->getDataLayout());
+
+    // Runtime entry points called from JIT'd code
+    defineHostSymbol("yeet_tier_up", reinterpret_cast<void*>(&Engine::tierUpTrampoline));
+    defineHostSymbol("yeet_index_fail", reinterpret_cast<void*>(&Engine::indexFailureTrampoline));
+    defineHostSymbol("yeet_slice_fail", reinterpret_cast<void*>(&Engine::sliceFailureTrampoline));
+    // Library calls for array copies and fills, and for loops the optimizer recognizes as one
+    defineHostSymbol("memcpy", reinterpret_cast<void*>(&std::memcpy));
+    defineHostSymbol("memmove", reinterpret_cast<void*>(&std::memmove));
+    defineHostSymbol("memset", reinterpret_cast<void*>(&std::memset));
+}
+
+void Engine::defineHostSymbol(const std::string& name, void* address)
+{
+    llvm::orc::SymbolMap symbols;
+    symbols[jit->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(address), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    if (auto err = jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+        std::cerr << "Failed to define host symbol " << name << ": " << llvm::toString(std::move(err)) << std::endl;
+    }
+}
+
+// Diagnostic like --stats and --remarks: on stderr, so it never mixes into an --emit artifact on stdout
+void Engine::printTargetInfo()
+{
+    auto targetMachine = targetBuilder->createTargetMachine();
+    if (!targetMachine) {
+        std::cerr << "Failed to create target machine: " << llvm::toString(targetMachine.takeError()) << std::endl;
+        return;
+    }
+    const llvm::MCSubtargetInfo* subtarget = (*targetMachine)->getMCSubtargetInfo();
+    std::string features;
+    for (const auto& feature : subtarget->getAllProcessorFeatures()) {
+        if (subtarget->getFeatureBits().test(feature.Value)) {
+            features += features.empty() ? "" : ",";
+            features += feature.Key;
+        }
+    }
+    std::cerr << "Target: " << targetBuilder->getTargetTriple().str() << "\n";
+    std::cerr << "CPU: " << targetBuilder->getCPU() << "\n";
+    std::cerr << "Tune CPU: " << (options.mcpu.empty() ? targetBuilder->getCPU() : options.mcpu) << "\n";
+    std::cerr << "Features: " << features << std::endl;
+}
+
+// Run the standard new pass manager pipeline for the given -O level
+void Engine::optimizeModule(llvm::Module& module, unsigned optLevel)
+{
+    // A TargetMachine per run: the optimizer needs its cost model to pick vector widths,
+    // and background tier-up compiles must not share one
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+    if (auto created = targetBuilder->createTargetMachine()) {
+        targetMachine = std::move(*created);
+    } else {
+        std::cerr << "Failed to create target machine: " << llvm::toString(created.takeError()) << std::endl;
+    }
+
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    // Per pass rows for --time-report and per pass spans for --trace
+    llvm::PassInstrumentationCallbacks instrumentation;
+    llvm::TimePassesHandler passTimers(options.timeReport);
+    passTimers.registerCallbacks(instrumentation);
+    if (llvm::timeTraceProfilerEnabled()) {
+        instrumentation.registerBeforeNonSkippedPassCallback([](llvm::StringRef pass, llvm::Any) {
+            llvm::timeTraceProfilerBegin(pass, "");
+        });
+        instrumentation.registerAfterPassCallback([](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses&) {
+            llvm::timeTraceProfilerEnd();
+        });
+        instrumentation.registerAfterPassInvalidatedCallback([](llvm::StringRef, const llvm::PreservedAnalyses&) {
+            llvm::timeTraceProfilerEnd();
+        });
+    }
+
+    llvm::PassBuilder passBuilder(targetMachine.get(), llvm::PipelineTuningOptions(), std::nullopt, &instrumentation);
+    passBuilder.registerModuleAnalyses(mam);
+    passBuilder.registerCGSCCAnalyses(cgam);
+    passBuilder.registerFunctionAnalyses(fam);
+    passBuilder.registerLoopAnalyses(lam);
+    passBuilder.crossRegisterProxies(lam, fam, cgam, mam);
+
+    llvm::ModulePassManager mpm;
+    switch (optLevel) {
+        case 0: mpm = passBuilder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0); break;
+        case 1: mpm = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1); break;
+        case 2: mpm = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2); break;
+        default: mpm = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3); break;
+    }
+    mpm.run(module, mam);
+}
+
+
+// calc returns the program's value in its own type: integers, floats and bool
+// directly, a struct or vector through an sret pointer to the caller's buffer.
+// Anything else makes it return double 0.
+// A program that ends in a definition returns what main returns instead.
+llvm::Function* Engine::createEntryFunction(const edn::EdnNode& root, llvm::Function*& mainFunc) {
+    const edn::EdnNode& last = root.metadata.count("sequence") ? root.values.back() : root;
+    bool endsInDefinition = last.type == edn::EdnList && !last.values.empty() && last.values.front().type == edn::EdnSymbol
+        && (last.values.front().value == "defn" || last.values.front().value == "struct");
+    auto mainIt = yeetFunctionTable.find("main");
+    mainFunc = nullptr;
+    entryType = typeOf(root);
+    if (endsInDefinition && mainIt != yeetFunctionTable.end() && mainIt->second.params.empty()) {
+        mainFunc = mainIt->second.function;
+        entryType = mainIt->second.returnType;
+    }
+    if (!entryType->isNumeric() && !entryType->isStruct() && !entryType->isVector()) {
+        entryType = types->float64Type();
+    }
+    llvm::FunctionType* funcType = nullptr;
+    if (entryType->isStruct() || entryType->isVector()) {
+        funcType = llvm::FunctionType::get(llvm::Type::getVoidTy(*context), {types->pointerTo(entryType)->llvmType}, false);
+    } else {
+        funcType = llvm::FunctionType::get(entryType->llvmType, false);
+    }
+    auto func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, "calc", mod.get());
+    if (entryType->isStruct() || entryType->isVector()) {
+        func->addParamAttr(0, llvm::Attribute::getWithStructRetType(*context, entryType->llvmType));
+        func->addParamAttr(0, llvm::Attribute::NoAlias);
+    } else if (entryType->isBool()) {
+        func->addRetAttr(llvm::Attribute::ZExt);
+    }
+    return func;
 }
 
+// calc's result as printed after "JIT result: ", read from memory laid out as type
+static std::string formatValue(TypeRef type, const void* data) {
+    if (type->isBool()) {
+        return *static_cast<const bool*>(data) ? "true" : "false";
+    }
+    if (type->isInteger()) {
+        int64_t value = 0;
+        switch (type->bits) {
+            case 8: value = *static_cast<const int8_t*>(data); break;
+            case 16: value = *static_cast<const int16_t*>(data); break;
+            case 32: value = *static_cast<const int32_t*>(data); break;
+            default: value = *static_cast<const int64_t*>(data); break;
+        }
+        return std::to_string(value);
+    }
+    if (type->isFloat()) {
+        std::ostringstream os;
+        if (type->bits == 32) os << *static_cast<const float*>(data);
+        else os << *static_cast<const double*>(data);
+        return os.str();
+    }
+    if (type->isPointer()) {
+        return fmt::format("{}", *static_cast<void* const*>(data));
+    }
+    if (type->isSlice()) {
+        auto fields = static_cast<const char*>(data);
+        return fmt::format("{}{{{}, {}}}", type->name, *reinterpret_cast<void* const*>(fields), *reinterpret_cast<const int64_t*>(fields + sizeof(void*)));
+    }
+    if (type->isVector()) {
+        std::string out = "<";
+        for (unsigned i = 0; i < type->lanes; ++i) {
+            if (i > 0) out += ", ";
+            if (type->element->isBool()) {
+                // Masks are stored one bit per lane
+                bool lane = (static_cast<const uint8_t*>(data)[i / 8] >> (i % 8)) & 1;
+                out += lane ? "true" : "false";
+            } else {
+                out += formatValue(type->element, static_cast<const char*>(data) + i * type->element->size);
+            }
+        }
+        return out + ">";
+    }
+    std::string out = type->name + "{";
+    for (const auto& field : type->fields) {
+        if (field.index > 0) out += ", ";
+        out += field.name + ": " + formatValue(field.type, static_cast<const char*>(data) + field.offset);
+    }
+    return out + "}";
+}
 
 void Engine::run(std::string& s)
 {
-    llvmSymbolTable.clear();
-    auto node = edn::read(s);
+    symbols.clear();
+    loopTargets.clear();
+    remarkDebugInfo.reset();
+    remarkScopes.clear();
+    yeetFunctionTable.clear();
+    yeetFunctionOrder.clear();
+    if (!options.profileUse.empty() && !loadProfile()) {
+        return;
+    }
+    std::list<edn::EdnToken> tokens;
+    {
+        PhaseScope phase(phaseTimer("Lex"), "Lex");
+        tokens = edn::lex(s);
+    }
+    edn::EdnNode node;
+    {
+        PhaseScope phase(phaseTimer("Parse"), "Parse");
+        node = edn::parse(std::move(tokens));
+    }
+    {
+        PhaseScope phase(phaseTimer("Typecheck"), "Typecheck");
+        TypeChecker(filePath).check(node);
+    }
+    if (options.astOpt) {
+        PhaseScope phase(phaseTimer("AST optimize"), "AstOptimize");
+        AstOptimizer().run(node);
+    }
+    std::optional<PhaseScope> codegenPhase(std::in_place, phaseTimer("Codegen"), "Codegen");
     mod = std::make_unique<llvm::Module>("calc_module", *context);
+    mod->setDataLayout(jit->getDataLayout());
+    mod->setTargetTriple(jit->getTargetTriple().str());
     llvm::IRBuilder<> builder(*context);
-    // Create function prototype: double calc()
-    auto funcType = llvm::FunctionType::get(builder.getDoubleTy(), false);
-    auto func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, "calc", mod.get());
-    auto entry = llvm::BasicBlock::Create(*context, "entry", func);
-    builder.SetInsertPoint(entry);
-    llvm::Value* result = nullptr;
     try {
-        result = this->codegenExpr(node, *context, builder);
+        this->declareGlobals(node, *context, builder);
+        llvm::Function* mainFunc = nullptr;
+        llvm::Function* func = createEntryFunction(node, mainFunc);
+        builder.SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", func));
+        if (!profileCounts.empty()) {
+            func->setEntryCount(1);
+        }
+        symbols.pushFunction();
+        llvm::Value* result = this->codegenExpr(node, *context, builder);
+        symbols.popFunction();
+        TypeRef resultType = typeOf(node);
+        if (mainFunc) {
+            // The program ended in a definition, its value is main's
+            result = builder.CreateCall(mainFunc, {}, "callmain");
+            resultType = yeetFunctionTable.at("main").returnType;
+        }
+        if (entryType->isStruct()) {
+            builder.CreateStore(result, func->getArg(0));
+            builder.CreateRetVoid();
+        } else if (entryType->isVector()) {
+            builder.CreateStore(convertValue(node, result, resultType, entryType, builder), func->getArg(0));
+            builder.CreateRetVoid();
+        } else if (entryType == resultType || (resultType->isNumeric() && entryType->isNumeric())) {
+            builder.CreateRet(convertValue(node, result, resultType, entryType, builder));
+        } else {
+            // Statements and pointers into calc's own frame have no value to hand back
+            builder.CreateRet(llvm::ConstantFP::get(builder.getDoubleTy(), 0.0));
+        }
+        // Every defn body on its own, calls only need the declarations
+        for (const auto& name : yeetFunctionOrder) {
+            this->codegenFunctionBody(yeetFunctionTable.at(name), *context);
+        }
     } catch (const char* msg) {
         std::cerr << "Codegen error: " << msg << std::endl;
         return;
@@ -65,35 +396,55 @@ void Engine::run(std::string& s)
         std::cerr << "Codegen error: " << msg << std::endl;
         return;
     }
-    // Only emit return if result is not nullptr (i.e., not a defn)
-    if (result) {
-        // If result is int, cast to double before returning
-        if (result->getType()->isIntegerTy()) {
-            result = builder.CreateSIToFP(result, builder.getDoubleTy(), "intToDouble");
+
+    if (!profileCounts.empty()) {
+        attachProfileSummary();
+    }
+    finalizeRemarks();
+    codegenPhase.reset();
+    if (!options.mcpu.empty()) {
+        for (auto& function : *mod) {
+            if (!function.isDeclaration()) {
+                function.addFnAttr("tune-cpu", options.mcpu);
+            }
         }
-        builder.CreateRet(result);
-    } else {
-        // If top-level was a defn, try to call 'main' if it exists
-        auto& moduleRef = *mod;
-        llvm::Function* mainFunc = moduleRef.getFunction("main");
-        if (mainFunc) {
-            llvm::IRBuilder<> callBuilder(entry);
-            llvm::Value* callResult = callBuilder.CreateCall(mainFunc, {}, "callmain");
-            callBuilder.CreateRet(callResult);
-        } else {
-            // No value to return, just return 0.0
-            builder.CreateRet(llvm::ConstantFP::get(builder.getDoubleTy(), 0.0));
+    }
+
+    if (options.stats) {
+        printFunctionStats(*mod, "before optimization");
+    }
+
+    // Artifacts that go through the code generator or get multiversioned are built from their own copy
+    std::unique_ptr<llvm::Module> artifactMod;
+    if (options.emit == EmitKind::Assembly || options.emit == EmitKind::Object || !options.multiversion.empty()) {
+        artifactMod = llvm::CloneModule(*mod);
+        if (options.emit == EmitKind::Assembly || options.emit == EmitKind::Object) {
+            trapBoundsFailures(*artifactMod);
         }
     }
 
-    
+    if (options.tiered) {
+        // Tier 0 runs unoptimized; keep a snapshot for the background -O3 recompiles
+        llvm::raw_string_ostream os(tierBitcode);
+        llvm::WriteBitcodeToFile(*mod, os);
+        os.flush();
+    } else if (options.optLevel > 0) {
+        PhaseScope phase(phaseTimer("Optimize"), "Optimize");
+        optimizeModule(*mod, options.optLevel);
+    }
+    if (options.stats && !options.tiered) {
+        printFunctionStats(*mod, fmt::format("after -O{}", options.optLevel));
+    }
 
-    // Print the generated LLVM IR
-    std::cout << "\n===== Generated LLVM IR =====\n";
-    std::cout << dumpModule();
-    std::cout << "\n============================\n" << std::endl;
+    if (options.emit != EmitKind::None) {
+        PhaseScope phase(phaseTimer("Emit"), "Emit");
+        emitArtifact(artifactMod ? *artifactMod : *mod, artifactMod != nullptr);
+        // The copy shares the context that is handed to the JIT below
+        artifactMod.reset();
+    }
 
-    // Add module to JIT
+    // Add module to JIT, the lookup is what runs the code generator and links
+    std::optional<PhaseScope> jitPhase(std::in_place, phaseTimer("JIT"), "JIT materialization");
     if (auto err = jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(mod), std::move(context)))) {
         std::cerr << "Failed to add module to JIT: " << llvm::toString(std::move(err)) << std::endl;
         return;
@@ -104,10 +455,38 @@ void Engine::run(std::string& s)
         std::cerr << "Failed to find function: " << llvm::toString(sym.takeError()) << std::endl;
         return;
     }
+    jitPhase.reset();
     try {
-        auto calcFn = sym->toPtr<double(*)()>();
-    
-        double value = calcFn();
+        PhaseScope phase(phaseTimer("Execute"), "Execute");
+        // Called through a pointer of exactly calc's signature, so integers never pass through a double
+        auto call = [&](auto calcFn) {
+            auto value = calcFn();
+            return formatValue(entryType, &value);
+        };
+        std::string value;
+        if (entryType->isStruct() || entryType->isVector()) {
+            // Filled through calc's sret argument, at the type's alignment (32 bytes for float32x8)
+            std::vector<char> buffer(entryType->size + entryType->alignment);
+            void* data = buffer.data();
+            size_t space = buffer.size();
+            std::align(entryType->alignment, entryType->size, data, space);
+            sym->toPtr<void(*)(void*)>()(data);
+            value = formatValue(entryType, data);
+        } else if (entryType->isBool()) {
+            value = call(sym->toPtr<bool(*)()>());
+        } else if (entryType->isInteger() && entryType->bits == 8) {
+            value = call(sym->toPtr<int8_t(*)()>());
+        } else if (entryType->isInteger() && entryType->bits == 16) {
+            value = call(sym->toPtr<int16_t(*)()>());
+        } else if (entryType->isInteger() && entryType->bits == 32) {
+            value = call(sym->toPtr<int32_t(*)()>());
+        } else if (entryType->isInteger()) {
+            value = call(sym->toPtr<int64_t(*)()>());
+        } else if (entryType->bits == 32) {
+            value = call(sym->toPtr<float(*)()>());
+        } else {
+            value = call(sym->toPtr<double(*)()>());
+        }
         std::cout << "JIT result: " << value << std::endl;
     }
     catch (const std::exception& e) {
@@ -116,17 +495,26 @@ void Engine::run(std::string& s)
     catch (...) {
         std::cerr << "Unknown error executing JIT function." << std::endl;
     }
-    
+
+    if (!options.profileGenerate.empty()) {
+        writeProfile();
+    }
+    if (phaseTimers) {
+        phaseTimers->print(llvm::errs(), true);
+    }
 }
 
 
 
+// Detail for trace spans: where in the .yeet file the form starts
+std::string yeet::traceDetail(const edn::EdnNode& node) {
+    return fmt::format("{}:{}", node.line, node.column);
+}
+
 // Helper for EdnInt
 llvm::Value* Engine::codegenInt(const edn::EdnNode& node, llvm::IRBuilder<>& builder) {
     if(node.metadata.count("type")) {
-        std::string typeStr = node.metadata.at("type");
-        llvm::Type* llvmType = getLLVMType(node, typeStr, builder);
-        return llvm::ConstantInt::get(llvmType, std::stoi(node.value));
+        return llvm::ConstantInt::get(typeOf(node)->llvmType, std::stoll(node.value), true);
     }
     return llvm::ConstantInt::get(builder.getInt32Ty(), std::stoi(node.value));
 }
@@ -134,13 +522,13 @@ llvm::Value* Engine::codegenInt(const edn::EdnNode& node, llvm::IRBuilder<>& bui
 // Helper for EdnFloat
 llvm::Value* Engine::codegenFloat(const edn::EdnNode& node, llvm::IRBuilder<>& builder) {
     if(node.metadata.count("type")) {
-        std::string typeStr = node.metadata.at("type");
-        if (typeStr == "float32") {
-            return llvm::ConstantFP::get(builder.getFloatTy(), std::stof(node.value));
-        } else if (typeStr == "float64") {
-            return llvm::ConstantFP::get(builder.getDoubleTy(), std::stod(node.value));
+        TypeRef type = typeOf(node);
+        if (type->isFloat() && type->bits == 32) {
+            return llvm::ConstantFP::get(type->llvmType, std::stof(node.value));
+        } else if (type->isFloat()) {
+            return llvm::ConstantFP::get(type->llvmType, std::stod(node.value));
         }
-        throw std::string("Unknown float type: ") + typeStr;
+        throw std::string("Unknown float type: ") + type->name;
     }
     return llvm::ConstantFP::get(builder.getDoubleTy(), std::stod(node.value));
 }
@@ -148,17 +536,18 @@ llvm::Value* Engine::codegenFloat(const edn::EdnNode& node, llvm::IRBuilder<>& b
 // Helper for EdnSymbol
 llvm::Value* Engine::codegenSymbol(const edn::EdnNode& node, llvm::IRBuilder<>& builder) {
     if (node.value == "else") {
-        return llvm::ConstantInt::get(builder.getInt32Ty(), 1);
-    }
-    auto it = llvmSymbolTable.find(node.value);
-    if (it == llvmSymbolTable.end()) throw YeetCompileException(node, fmt::format("Unknown variable: {}", node.value), filePath, __FILE__, __LINE__);
-    llvm::Value* alloca = it->second.first;
-    std::string typeStr = it->second.second;
-    llvm::Type* varType = getLLVMType(node, typeStr, builder);
-    return builder.CreateLoad(varType, alloca, node.value);
+        return builder.getTrue();
+    }
+    SymbolTable::Symbol* symbol = symbols.lookup(node.value);
+    if (!symbol) throw YeetCompileException(node, fmt::format("Unknown variable: {}", node.value), filePath, __FILE__, __LINE__);
+    llvm::Value* alloca = symbol->value;
+    // An array is never loaded as a whole, it stands for its address
+    if (symbol->type->isArray() || symbol->constant) return alloca;
+    return builder.CreateLoad(typeOf(node)->llvmType, alloca, node.value);
 }
 
 llvm::Value* Engine::codegenAssign(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenAssign", [&] { return traceDetail(node); });
     using namespace edn;
 
 
@@ -203,25 +592,31 @@ llvm::Value* Engine::codegenAssignStruct(const edn::EdnNode& node, llvm::LLVMCon
     auto structIt = structDeclarationNode.values.begin();
     const edn::EdnNode& structNameNode = *structIt;
     if (structNameNode.type != edn::EdnSymbol) throw YeetCompileException(structNameNode, "Expected Struct name to be a symbol", filePath, __FILE__, __LINE__);
-    if(llvmStructTypes.find(structNameNode.value) == llvmStructTypes.end()) {
+    TypeRef structType = types->lookup(structNameNode.value);
+    if (!structType || !structType->isStruct()) {
         throw YeetCompileException(structNameNode, fmt::format("Struct type not defined: {}", structNameNode.value), filePath, __FILE__, __LINE__);
     }
     ++structIt; 
     const edn::EdnNode& fieldsNode = *structIt;
     if (fieldsNode.type != edn::EdnList) throw YeetCompileException(fieldsNode, "Expected Struct fields", filePath, __FILE__, __LINE__);
     std::vector<llvm::Value*> fieldValues;
-    for (auto fieldIt = fieldsNode.values.begin(); fieldIt != fieldsNode.values.end(); ++fieldIt) {
+    const auto& fields = structType->fields;
+    size_t fieldIndex = 0;
+    for (auto fieldIt = fieldsNode.values.begin(); fieldIt != fieldsNode.values.end(); ++fieldIt, ++fieldIndex) {
         llvm::Value* fieldValue = this->codegenExpr(*fieldIt, context, builder);
-        fieldValues.push_back(fieldValue);
+        fieldValues.push_back(convertValue(*fieldIt, fieldValue, typeOf(*fieldIt), fields[fieldIndex].type, builder));
     }
     // Create struct instance with variable name and store pointer in symbol table
-    llvm::Type* structType = llvmStructTypes.at(structNameNode.value);
-    llvm::Value* structPtr = builder.CreateAlloca(structType, nullptr, targetNode.value);
+    llvm::Value* structPtr = createEntryAlloca(builder, structType->llvmType, targetNode.value);
     for (size_t i = 0; i < fieldValues.size(); ++i) {
-        auto gep = builder.CreateStructGEP(structType, structPtr, i);
+        auto gep = builder.CreateStructGEP(structType->llvmType, structPtr, i);
         builder.CreateStore(fieldValues[i], gep);
     }
-    llvmSymbolTable[targetNode.value] = {structPtr, structNameNode.value};
+    if (SymbolTable::Symbol* symbol = symbols.lookup(targetNode.value)) {
+        symbol->value = structPtr;
+    } else {
+        symbols.declare(targetNode.value, structPtr, structType);
+    }
     return structPtr;
 }
 
@@ -251,43 +646,12 @@ llvm::Value* Engine::codegenAssignStructField(const edn::EdnNode& node, llvm::LL
     if (fieldNode.type != edn::EdnKeyword) {
         throw YeetCompileException(fieldNode, "Expected Struct field to be a keyword", filePath, __FILE__, __LINE__);
     }
-    auto symbolIt = llvmSymbolTable.find(structTargetNode.value);
-    if (symbolIt == llvmSymbolTable.end()) {
-        throw YeetCompileException(structTargetNode, fmt::format("Struct target not defined: {}", structTargetNode.value), filePath, __FILE__, __LINE__);
-    }
-    std::string structName = symbolIt->second.second;
-    std::string fieldName = fieldNode.value.substr(1); // Remove leading ':'
-    auto yeetStructValueIt = yeetStructTable.find(structName);
-    if (yeetStructValueIt == yeetStructTable.end()) {
-        throw YeetCompileException(structTargetNode, fmt::format("Struct not defined: {}", structName), filePath, __FILE__, __LINE__);
-    }
-    auto& yeetStructType = yeetStructValueIt->second;
-    // Test if variable is a pointer to a struct
-    auto structTypePointer = symbolIt->second.first;
-    // lookup llvm struct type definition
-    auto llvmStructTypeDefIt = llvmStructTypes.find(structName);
-    if (llvmStructTypeDefIt == llvmStructTypes.end()) {
-        throw YeetCompileException(structTargetNode, fmt::format("Struct type not defined: {}", structName), filePath, __FILE__, __LINE__);
-    }
-    auto llvmStructTypeDef = llvmStructTypeDefIt->second;
-    // Lookup field index in struct type
-    auto fieldIndexIt = yeetStructType.begin();
-    for (; fieldIndexIt != yeetStructType.end(); ++fieldIndexIt) {
-        if (fieldIndexIt->first == fieldName) break;
-    }
-    if (fieldIndexIt == yeetStructType.end()) {
-        throw YeetCompileException(fieldNode, fmt::format("Field not a member of struct: {} in struct {}", fieldName, structName), filePath, __FILE__, __LINE__);
-    }
-    auto fieldIndexId = std::distance(yeetStructType.begin(), fieldIndexIt);
-    auto fieldType = fieldIndexIt->second;
+    auto [gep, field] = structFieldAddress(structTargetNode, fieldNode, builder);
     // 3_ extract value node
     ++it; // Move to value node
     const edn::EdnNode& valueNode = *it;
     llvm::Value* value = this->codegenExpr(valueNode, context, builder);
-    if (value->getType() != getLLVMType(node, fieldType, builder)) {
-        throw YeetCompileException(valueNode, fmt::format("Value type mismatch for field: {}", fieldName), filePath, __FILE__, __LINE__);
-    }
-    auto gep = builder.CreateStructGEP(llvmStructTypeDef, structTypePointer,  fieldIndexId);
+    value = convertValue(valueNode, value, typeOf(valueNode), field->type, builder);
     return builder.CreateStore(value, gep);
 }
 
@@ -302,41 +666,27 @@ llvm::Value* Engine::codegenAssignLiteral(const edn::EdnNode& node, llvm::LLVMCo
     // 2) Extract type Node
     const edn::EdnNode& typeNode = *it;
     if (typeNode.type != edn::EdnKeyword) throw YeetCompileException(typeNode, "Expected type keyword", filePath, __FILE__, __LINE__);
-    std::string typeStr = typeNode.value.substr(1); // remove leading ':'
+    TypeRef type = resolveType(typeNode, typeNode.value.substr(1)); // remove leading ':'
+    if (type->isArray()) {
+        return this->codegenAssignArray(node, context, builder);
+    }
     ++it; // valueNode
 
-    edn::EdnNode valueNode = *it;
+    const edn::EdnNode& valueNode = *it;
 
-    llvm::Value* value = nullptr;
     llvm::Value* lvaluePtr = nullptr;
-
-    // Handle codegen for valueNode
-    if (valueNode.type == edn::EdnInt || valueNode.type == edn::EdnFloat) {
-        valueNode.metadata["type"] = typeStr;
-        value = this->codegenExpr(valueNode, context, builder);
-    }
-    else if(valueNode.type == edn::EdnSymbol) {
-        // If it's a symbol, just load the value
-        value = this->codegenSymbol(valueNode, builder);
-    }
-    else if(valueNode.type == edn::EdnList) {
-        // If it's a list, treat it as a struct or function call
-        value = this->codegenList(valueNode, context, builder);
-    }
-    else {
-        throw YeetCompileException(valueNode, "Expected value to be an int, float, symbol, or list.", filePath, __FILE__, __LINE__);
-    }
-
-    llvm::Type* llvmType = getLLVMType(node, typeStr, builder);
+    // Literals already carry the declared type, anything else is converted to it
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    value = convertValue(valueNode, value, typeOf(valueNode), type, builder);
 
     // If target is a symbol, assign as before
     if (targetNode.type == edn::EdnSymbol) {
-        auto symIt = llvmSymbolTable.find(targetNode.value);
-        if (symIt == llvmSymbolTable.end()) {
-            lvaluePtr = builder.CreateAlloca(llvmType, nullptr, targetNode.value);
-            llvmSymbolTable[targetNode.value] = std::make_pair(lvaluePtr, typeStr);
+        SymbolTable::Symbol* symbol = symbols.lookup(targetNode.value);
+        if (!symbol) {
+            lvaluePtr = createEntryAlloca(builder, type->llvmType, targetNode.value);
+            symbols.declare(targetNode.value, lvaluePtr, type);
         } else {
-            lvaluePtr = symIt->second.first;
+            lvaluePtr = symbol->value;
         }
         builder.CreateStore(value, lvaluePtr);
         return value;
@@ -361,7 +711,7 @@ llvm::Value* Engine::codegenList(const edn::EdnNode& node, llvm::LLVMContext& co
     // If this is a sequence of expressions (not an operation), evaluate each and return the last
     bool allAreLists = true;
     for (const auto& v : node.values) {
-        if (v.type != EdnList && v.type != EdnInt && v.type != EdnSymbol && v.type != EdnFloat) {
+        if (v.type != EdnList && v.type != EdnInt && v.type != EdnSymbol && v.type != EdnFloat && v.type != EdnBool) {
             allAreLists = false;
             break;
         }
@@ -386,12 +736,18 @@ llvm::Value* Engine::codegenList(const edn::EdnNode& node, llvm::LLVMContext& co
     if (op == "deref") {
         return this->codegenDereference(node, context, builder);
     }
-    if (op == "defn") {
-        return this->codegenDefn(node, context, builder);
-    }
     if (op == "cond") {
         return this->codegenCond(node, context, builder);
     }
+    if (op == "select") {
+        return this->codegenSelect(node, context, builder);
+    }
+    if (op == "case") {
+        return this->codegenCase(node, context, builder);
+    }
+    if (op == "def" || op == "const") {
+        return this->codegenDef(node, context, builder);
+    }
     if (op == "=") {
         return this->codegenAssign(node, context, builder);
     }
@@ -401,26 +757,42 @@ llvm::Value* Engine::codegenList(const edn::EdnNode& node, llvm::LLVMContext& co
     if (op == "while") {
         return this->codegenWhile(node, context, builder);
     }
-    if (op == "struct") {
-        // (struct name ((field1 :type1) (field2 :type2) ...))
-        if (node.values.size() != 3) throw YeetCompileException(node, "struct requires a name and a field list", filePath, __FILE__, __LINE__);
-        auto it = node.values.begin();
-        ++it; // nameNode
-        const edn::EdnNode& nameNode = *it;
-        ++it; // fieldsNode
-        const edn::EdnNode& fieldsNode = *it;
-        if (nameNode.type != edn::EdnSymbol) throw YeetCompileException(nameNode, "struct: name must be a symbol", filePath, __FILE__, __LINE__);
-        if (fieldsNode.type != edn::EdnList) throw YeetCompileException(fieldsNode, "struct: fields must be a list", filePath, __FILE__, __LINE__);
-        std::vector<std::pair<std::string, std::string>> fields;
-        for (const auto& field : fieldsNode.values) {
-            if (field.type == edn::EdnList && field.values.size() == 2 && field.values.front().type == edn::EdnSymbol && field.values.back().type == edn::EdnKeyword) {
-                fields.push_back({field.values.front().value, field.values.back().value.substr(1)});
-            } else {
-                throw YeetCompileException(field, "struct: each field must be (name :type)", filePath, __FILE__, __LINE__);
-            }
-        }
-        this->defineStructType(nameNode, fields, builder, context);
-        return nullptr; // struct definition does not produce a value
+    if (op == "for") {
+        return this->codegenFor(node, context, builder);
+    }
+    if (op == "break" || op == "continue") {
+        return this->codegenLoopExit(node, context, builder);
+    }
+    if (op == "splat") {
+        return this->codegenSplat(node, context, builder);
+    }
+    if (op == "extract") {
+        return this->codegenExtract(node, context, builder);
+    }
+    if (op == "insert") {
+        return this->codegenInsert(node, context, builder);
+    }
+    if (op == "shuffle") {
+        return this->codegenShuffle(node, context, builder);
+    }
+    if (op == "reduce") {
+        return this->codegenReduce(node, context, builder);
+    }
+    if (op == "at") {
+        return this->codegenAt(node, context, builder);
+    }
+    if (op == "set-at") {
+        return this->codegenSetAt(node, context, builder);
+    }
+    if (op == "len") {
+        return this->codegenLen(node, context, builder);
+    }
+    if (op == "slice") {
+        return this->codegenSlice(node, context, builder);
+    }
+    if (op == "struct" || op == "defn") {
+        // Declared by declareGlobals, defn bodies are generated after calc
+        return nullptr;
     }
     if(op == "+" || op == "-" || op == "*" || op == "/" || op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=") {
         return this->codegenBinop(node, context, builder);
@@ -434,6 +806,7 @@ llvm::Value* Engine::codegenList(const edn::EdnNode& node, llvm::LLVMContext& co
 }
 
 llvm::Value* Engine::codegenAssignPointer(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenAssignPointer", [&] { return traceDetail(node); });
     using namespace edn;
     // Pointer assignment: (put target :type value)
     if (node.values.size() != 4) throw YeetCompileException(node, "put expects target, type, and value", filePath, __FILE__, __LINE__);
@@ -443,34 +816,22 @@ llvm::Value* Engine::codegenAssignPointer(const edn::EdnNode& node, llvm::LLVMCo
     ++it; // typeNode
     const edn::EdnNode& typeNode = *it;
     if (typeNode.type != edn::EdnKeyword) throw YeetCompileException(typeNode, "put expects type keyword", filePath, __FILE__, __LINE__);
-    std::string typeStr = typeNode.value.substr(1); // remove leading ':'
+    TypeRef type = resolveType(typeNode, typeNode.value.substr(1)); // remove leading ':'
     ++it; // valueNode
-    edn::EdnNode valueNode = *it;
-    llvm::Value* value = nullptr;
-    // Handle codegen for valueNode
-    if (valueNode.type == EdnInt || valueNode.type == EdnFloat) {
-        valueNode.metadata["type"] = typeStr;
-        value = this->codegenExpr(valueNode, context, builder);
-    } else if (valueNode.type == EdnSymbol) {
-        value = this->codegenSymbol(valueNode, builder);
-    } else if (valueNode.type == EdnList) {
-        value = this->codegenList(valueNode, context, builder);
-    } else {
-        throw YeetCompileException(valueNode, "put expects value to be int, float, symbol, or list", filePath, __FILE__, __LINE__);
-    }
+    const edn::EdnNode& valueNode = *it;
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    value = convertValue(valueNode, value, typeOf(valueNode), type, builder);
     
     // Target must produce a pointer
     llvm::Value* ptr = nullptr;
     if (targetNode.type == EdnSymbol) {
         // Direct symbol: must be a pointer variable
-        auto symIt = llvmSymbolTable.find(targetNode.value);
-        if (symIt == llvmSymbolTable.end()) {
+        SymbolTable::Symbol* symbol = symbols.lookup(targetNode.value);
+        if (!symbol) {
             throw YeetCompileException(targetNode, fmt::format("Unknown variable for pointer assignment: {}", targetNode.value), filePath, __FILE__, __LINE__);
         }
-        ptr = symIt->second.first;
-        std::string typeStr = symIt->second.second;
-        llvm::Type* type = getLLVMType(targetNode, typeStr, builder);
-        if (!type->isPointerTy()) {
+        ptr = symbol->value;
+        if (!symbol->type->isPointer()) {
             throw YeetCompileException(targetNode, fmt::format("Variable {} is not a pointer type", targetNode.value), filePath, __FILE__, __LINE__);
         }
         // For function arguments, ptr is already the pointer variable (no extra load needed)
@@ -491,6 +852,7 @@ llvm::Value* Engine::codegenAssignPointer(const edn::EdnNode& node, llvm::LLVMCo
 
 // Reference: (& x) returns pointer to x
 llvm::Value* Engine::codegenReference(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenReference", [&] { return traceDetail(node); });
     // Expect: (& x)
     if (node.values.size() != 2)
         throw YeetCompileException(node, "Reference operator expects one argument", filePath, __FILE__, __LINE__);
@@ -499,15 +861,16 @@ llvm::Value* Engine::codegenReference(const edn::EdnNode& node, llvm::LLVMContex
     const edn::EdnNode& targetNode = *it;
     if (targetNode.type != edn::EdnSymbol)
         throw YeetCompileException(targetNode, "Reference operator expects a symbol argument", filePath, __FILE__, __LINE__);
-    auto symIt = llvmSymbolTable.find(targetNode.value);
-    if (symIt == llvmSymbolTable.end())
+    SymbolTable::Symbol* symbol = symbols.lookup(targetNode.value);
+    if (!symbol)
         throw YeetCompileException(targetNode, fmt::format("Unknown variable for reference: {}", targetNode.value), filePath, __FILE__, __LINE__);
     // Return the alloca pointer
-    return symIt->second.first;
+    return symbol->value;
 }
 
 // Dereference: (* p) loads value from pointer p
 llvm::Value* Engine::codegenDereference(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenDereference", [&] { return traceDetail(node); });
     // Expect: (* p)
     if (node.values.size() != 2)
         throw YeetCompileException(node, "Dereference operator expects one argument", filePath, __FILE__, __LINE__);
@@ -515,30 +878,15 @@ llvm::Value* Engine::codegenDereference(const edn::EdnNode& node, llvm::LLVMCont
     ++it; // Skip '*'
     const edn::EdnNode& pointerNode = *it;
     llvm::Value* ptrValue = nullptr;
-    llvm::Type* pointeeType = nullptr;
+    llvm::Type* pointeeType = typeOf(node)->llvmType;
     if (pointerNode.type == edn::EdnSymbol) {
-        auto symIt = llvmSymbolTable.find(pointerNode.value);
-        if (symIt == llvmSymbolTable.end())
+        SymbolTable::Symbol* symbol = symbols.lookup(pointerNode.value);
+        if (!symbol)
             throw YeetCompileException(pointerNode, fmt::format("Unknown pointer variable: {}", pointerNode.value), filePath, __FILE__, __LINE__);
-        ptrValue = symIt->second.first;
-        // Look up the type string for the symbol
-        std::string typeStr = symIt->second.second;
-        // Strip trailing '*' for dereference
-        if (!typeStr.empty() && typeStr.back() == '*') {
-            typeStr = typeStr.substr(0, typeStr.size() - 1);
-        }
-        pointeeType = getLLVMType(pointerNode, typeStr, builder);
+        ptrValue = symbol->value;
     } else {
         // Allow dereferencing the result of an expression
         ptrValue = this->codegenExpr(pointerNode, context, builder);
-        // Try to get type from metadata if available
-        if (pointerNode.metadata.count("type")) {
-            std::string typeStr = pointerNode.metadata.at("type");
-            pointeeType = getLLVMType(pointerNode, typeStr, builder);
-        } else {
-            // Fallback: int32 (could be improved by propagating type info)
-            pointeeType = builder.getInt32Ty();
-        }
     }
     // Type check: must be pointer
     auto ptrType = llvm::dyn_cast<llvm::PointerType>(ptrValue->getType());
@@ -548,8 +896,47 @@ llvm::Value* Engine::codegenDereference(const edn::EdnNode& node, llvm::LLVMCont
 }
 
 
-// (defn name (args...) body...)
-llvm::Value* Engine::codegenDefn(const edn::EdnNode& node, llvm::LLVMContext&, llvm::IRBuilder<>&) {
+// Structs and function signatures, in source order, before any code is generated.
+// Every defn can then be called from anywhere, including before its definition.
+void Engine::declareGlobals(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    if (node.type != edn::EdnList || node.values.empty()) return;
+    const edn::EdnNode& opNode = node.values.front();
+    if (opNode.type == edn::EdnSymbol && opNode.value == "struct") {
+        declareStruct(node, context, builder);
+        return;
+    }
+    if (opNode.type == edn::EdnSymbol && opNode.value == "defn") {
+        declareFunction(node);
+    }
+    for (const auto& child : node.values) {
+        declareGlobals(child, context, builder);
+    }
+}
+
+// (struct name ((field1 :type1) (field2 :type2) ...))
+void Engine::declareStruct(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    if (node.values.size() != 3) throw YeetCompileException(node, "struct requires a name and a field list", filePath, __FILE__, __LINE__);
+    auto it = node.values.begin();
+    ++it; // nameNode
+    const edn::EdnNode& nameNode = *it;
+    ++it; // fieldsNode
+    const edn::EdnNode& fieldsNode = *it;
+    if (nameNode.type != edn::EdnSymbol) throw YeetCompileException(nameNode, "struct: name must be a symbol", filePath, __FILE__, __LINE__);
+    if (fieldsNode.type != edn::EdnList) throw YeetCompileException(fieldsNode, "struct: fields must be a list", filePath, __FILE__, __LINE__);
+    std::vector<std::pair<std::string, std::string>> fields;
+    for (const auto& field : fieldsNode.values) {
+        if (field.type == edn::EdnList && field.values.size() == 2 && field.values.front().type == edn::EdnSymbol && field.values.back().type == edn::EdnKeyword) {
+            fields.push_back({field.values.front().value, field.values.back().value.substr(1)});
+        } else {
+            throw YeetCompileException(field, "struct: each field must be (name :type)", filePath, __FILE__, __LINE__);
+        }
+    }
+    this->defineStructType(nameNode, fields, builder, context);
+}
+
+// (defn :ret name (args...) body...): the signature and an llvm::Function without a body
+void Engine::declareFunction(const edn::EdnNode& node) {
+    llvm::TimeTraceScope timeScope("declareFunction", [&] { return traceDetail(node); });
     using namespace edn;
     if (node.values.size() < 5) throw YeetCompileException(node, "defn requires a return type, name, arg list, and body", filePath, __FILE__, __LINE__);
     const EdnNode& retTypeNode = *(++node.values.begin());
@@ -558,107 +945,102 @@ llvm::Value* Engine::codegenDefn(const edn::EdnNode& node, llvm::LLVMContext&, l
     if (retTypeNode.type != EdnKeyword) throw YeetCompileException(retTypeNode, "defn: first argument must be return type keyword", filePath, __FILE__, __LINE__);
     if (nameNode.type != EdnSymbol) throw YeetCompileException(nameNode, "defn: function name must be a symbol", filePath, __FILE__, __LINE__);
     if (argsNode.type != EdnList) throw YeetCompileException(argsNode, "defn: argument list must be a list", filePath, __FILE__, __LINE__);
-    std::string retType = retTypeNode.value.substr(1); // remove leading ':'
-    std::vector<std::pair<std::string, std::string>> args;
+    FunctionInfo function;
+    function.node = &node;
+    function.returnType = resolveType(retTypeNode, retTypeNode.value.substr(1)); // remove leading ':'
     for (const auto& arg : argsNode.values) {
         if (arg.type == EdnList && arg.values.size() == 2 && arg.values.front().type == EdnSymbol && arg.values.back().type == EdnKeyword) {
-            args.push_back({arg.values.front().value, arg.values.back().value.substr(1)});
+            function.params.push_back({arg.values.front().value, resolveType(arg.values.back(), arg.values.back().value.substr(1))});
         } else if (arg.type == EdnSymbol) {
-            args.push_back({arg.value, "int32"});
+            function.params.push_back({arg.value, resolveType(arg, "int32")});
         } else {
             throw YeetCompileException(arg, "defn: all arguments must be symbols or (name :type)", filePath, __FILE__, __LINE__);
         }
     }
-    EdnNode bodyNode = node;
-    bodyNode.values.erase(bodyNode.values.begin(), std::next(bodyNode.values.begin(), 4));
-    yeetFunctionTable[nameNode.value] = {args, bodyNode};
-    yeetFunctionReturnTypes[nameNode.value] = retType;
-    return nullptr; // defn does not produce a value
+    std::vector<llvm::Type*> paramTypes;
+    for (const auto& param : function.params) {
+        paramTypes.push_back(param.second->llvmType);
+    }
+    auto funcType = llvm::FunctionType::get(function.returnType->llvmType, paramTypes, false);
+    function.function = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, nameNode.value, mod.get());
+    yeetFunctionOrder.push_back(nameNode.value);
+    yeetFunctionTable[nameNode.value] = std::move(function);
+}
+
+// Body of a declared defn, generated on its own once calc is done: its own builder,
+// and a function scope that holds only its arguments
+void Engine::codegenFunctionBody(FunctionInfo& function, llvm::LLVMContext& context) {
+    const edn::EdnNode& node = *function.node;
+    llvm::TimeTraceScope timeScope("codegenFunctionBody", [&] { return traceDetail(node); });
+    llvm::Function* func = function.function;
+    std::string name = func->getName().str();
+    llvm::BasicBlock* entry = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::IRBuilder<> funcBuilder(entry);
+    if (options.tiered) {
+        emitTierPrologue(func, funcBuilder);
+    }
+    std::string entryKey = profileKey("defn", node, name);
+    emitProfileCounter(entryKey, funcBuilder);
+    if (!profileCounts.empty()) {
+        func->setEntryCount(profileCount(entryKey));
+    }
+    symbols.pushFunction();
+    auto argIt = func->arg_begin();
+    for (const auto& [paramName, paramType] : function.params) {
+        // If argument is a pointer type, store the argument value directly in the symbol table
+        if (paramType->isPointer()) {
+            symbols.declare(paramName, &*argIt, paramType);
+        } else {
+            llvm::Value* alloca = createEntryAlloca(funcBuilder, paramType->llvmType, paramName);
+            funcBuilder.CreateStore(&*argIt, alloca);
+            symbols.declare(paramName, alloca, paramType);
+        }
+        ++argIt;
+    }
+    // Body statements follow (defn :ret name (args...))
+    llvm::Value* result = nullptr;
+    const edn::EdnNode* resultNode = nullptr;
+    for (auto it = std::next(node.values.begin(), 4); it != node.values.end(); ++it) {
+        result = this->codegenExpr(*it, context, funcBuilder);
+        resultNode = &*it;
+    }
+    symbols.popFunction();
+    if (!function.returnType->isVoid()) {
+        funcBuilder.CreateRet(convertValue(*resultNode, result, typeOf(*resultNode), function.returnType, funcBuilder));
+    } else {
+        funcBuilder.CreateRetVoid();
+    }
 }
 
 // (name arg1 arg2 ...)
 llvm::Value* Engine::codegenCall(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenCall", [&] { return traceDetail(node); });
     using namespace edn;
     const EdnNode& opNode = node.values.front();
     auto it = yeetFunctionTable.find(opNode.value);
     if (it == yeetFunctionTable.end()) throw std::string("Unknown function: ") + opNode.value;
-    const auto& [args, bodyNode] = it->second;
-    if (node.values.size() - 1 != args.size()) throw "Function argument count mismatch";
-    // Get return type
-    std::string retType = "double";
-    auto retIt = yeetFunctionReturnTypes.find(opNode.value);
-    if (retIt != yeetFunctionReturnTypes.end()) retType = retIt->second;
-    llvm::Type* llvmRetType = getLLVMType(node, retType, builder);
-    // Create function type
-    std::vector<llvm::Type*> argTypes;
-    for (const auto& arg : args) {
-        argTypes.push_back(getLLVMType(node, arg.second, builder));
-    }
-    auto funcType = llvm::FunctionType::get(llvmRetType, argTypes, false);
-    auto& module = *builder.GetInsertBlock()->getModule();
-    llvm::Function* func = module.getFunction(opNode.value);
-    if (!func) {
-        func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, opNode.value, &module);
-        llvm::BasicBlock* entry = llvm::BasicBlock::Create(context, "entry", func);
-        llvm::IRBuilder<> funcBuilder(entry);
-        auto argIt = func->arg_begin();
-        for (size_t i = 0; i < args.size(); ++i, ++argIt) {
-            llvm::Type* argType = argTypes[i];
-            // If argument is a pointer type, store the argument value directly in the symbol table
-            if (argType->isPointerTy()) {
-                llvmSymbolTable[args[i].first] = std::make_pair(&*argIt, args[i].second);
-            } else {
-                llvm::Value* alloca = funcBuilder.CreateAlloca(argType, nullptr, args[i].first);
-                funcBuilder.CreateStore(&*argIt, alloca);
-                llvmSymbolTable[args[i].first] = std::make_pair(alloca, args[i].second);
-            }
-        }
-        llvm::Value* result = nullptr;
-        for (const auto& expr : bodyNode.values) {
-            result = this->codegenExpr(expr, context, funcBuilder);
-        }
-        if (retType != "void") {
-            // If result type doesn't match return type, cast
-            if (result && result->getType() != llvmRetType) {
-                if (llvmRetType->isFloatingPointTy() && result->getType()->isIntegerTy()) {
-                    result = funcBuilder.CreateSIToFP(result, llvmRetType, "intToFloatRet");
-                } else if (llvmRetType->isIntegerTy() && result->getType()->isFloatingPointTy()) {
-                    result = funcBuilder.CreateFPToSI(result, llvmRetType, "floatToIntRet");
-                } else if (llvmRetType->isIntegerTy() && result->getType()->isIntegerTy() && llvmRetType != result->getType()) {
-                    result = funcBuilder.CreateIntCast(result, llvmRetType, true, "intCastRet");
-                }
-            }
-            funcBuilder.CreateRet(result);
-        } else {
-            funcBuilder.CreateRetVoid();
-        }
-    }
+    const FunctionInfo& function = it->second;
+    if (node.values.size() - 1 != function.params.size()) throw "Function argument count mismatch";
     std::vector<llvm::Value*> callArgs;
     auto argNodeIt = std::next(node.values.begin());
-    for (size_t i = 0; i < args.size(); ++i, ++argNodeIt) {
+    for (size_t i = 0; i < function.params.size(); ++i, ++argNodeIt) {
         llvm::Value* argVal = this->codegenExpr(*argNodeIt, context, builder);
-        llvm::Type* expectedType = argTypes[i];
-        llvm::Type* actualType = argVal->getType();
-        if (expectedType != actualType) {
-            if (expectedType->isFloatingPointTy() && actualType->isIntegerTy()) {
-                argVal = builder.CreateSIToFP(argVal, expectedType, "intToFloatArg");
-            } else if (expectedType->isIntegerTy() && actualType->isFloatingPointTy()) {
-                argVal = builder.CreateFPToSI(argVal, expectedType, "floatToIntArg");
-            } else if (expectedType->isIntegerTy() && actualType->isIntegerTy() && expectedType != actualType) {
-                argVal = builder.CreateIntCast(argVal, expectedType, true, "intCastArg");
-            }
-        }
-        callArgs.push_back(argVal);
+        callArgs.push_back(convertValue(*argNodeIt, argVal, typeOf(*argNodeIt), function.params[i].second, builder));
+    }
+    if (options.tiered) {
+        return emitTieredCall(function.function, callArgs, builder);
     }
-    return builder.CreateCall(func, callArgs, "calltmp");
+    // Void calls cannot be named
+    return builder.CreateCall(function.function, callArgs, function.returnType->isVoid() ? "" : "calltmp");
 }
 
 llvm::Value* Engine::codegenWhile(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenWhile", [&] { return traceDetail(node); });
     using namespace edn;
-    // (while test body)
-    if (node.values.size() != 3) throw YeetCompileException(node, "while requires a test and a body", filePath, __FILE__, __LINE__);
+    // (while test [hints...] body)
+    if (node.values.size() < 3) throw YeetCompileException(node, "while requires a test and a body", filePath, __FILE__, __LINE__);
     const EdnNode& testNode = *(++node.values.begin());
-    const EdnNode& bodyNode = *(++++node.values.begin());
+    const EdnNode& bodyNode = node.values.back();
     llvm::Function* function = builder.GetInsertBlock()->getParent();
     llvm::BasicBlock* condBB = llvm::BasicBlock::Create(context, "while.cond", function);
     llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(context, "while.body", function);
@@ -667,22 +1049,151 @@ llvm::Value* Engine::codegenWhile(const edn::EdnNode& node, llvm::LLVMContext& c
     // Condition block
     builder.SetInsertPoint(condBB);
     llvm::Value* condVal = this->codegenExpr(testNode, context, builder);
-    if (condVal->getType()->isFloatingPointTy()) {
-        condVal = builder.CreateFCmpONE(condVal, llvm::ConstantFP::get(condVal->getType(), 0.0), "whilecond");
-    } else {
-        condVal = builder.CreateICmpNE(condVal, llvm::ConstantInt::get(condVal->getType(), 0), "whilecond");
-    }
-    builder.CreateCondBr(condVal, bodyBB, afterBB);
+    condVal = convertValue(testNode, condVal, typeOf(testNode), types->boolType(), builder);
+    auto condBr = builder.CreateCondBr(condVal, bodyBB, afterBB);
+    std::string bodyKey = profileKey("while", node, "body");
+    std::string exitKey = profileKey("while", node, "exit");
+    setBranchWeights(condBr, profileCount(bodyKey), profileCount(exitKey));
     // Body block
     builder.SetInsertPoint(bodyBB);
+    emitProfileCounter(bodyKey, builder);
+    symbols.pushScope();
+    loopTargets.push_back({condBB, afterBB});
     this->codegenExpr(bodyNode, context, builder);
+    loopTargets.pop_back();
+    symbols.popScope();
+    setLoopMetadata(builder.CreateBr(condBB), node);
+    // After block
+    builder.SetInsertPoint(afterBB);
+    emitProfileCounter(exitKey, builder);
+    return nullptr;
+}
+
+
+// (for (i start end step) [hints...] body): bounds and step are evaluated once up front and i
+// is a single induction variable stepped in the latch, the shape LLVM's loop
+// passes compute trip counts for. A literal negative step counts down to end,
+// any other step counts up. continue goes to the latch, break past the loop.
+llvm::Value* Engine::codegenFor(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenFor", [&] { return traceDetail(node); });
+    using namespace edn;
+    if (node.values.size() < 3) throw YeetCompileException(node, "for requires (var start end [step]) and a body", filePath, __FILE__, __LINE__);
+    const EdnNode& headNode = *std::next(node.values.begin());
+    const EdnNode& bodyNode = node.values.back();
+    const EdnNode& varNode = headNode.values.front();
+    TypeRef varType = typeOf(varNode);
+    auto boundIt = std::next(headNode.values.begin());
+    const EdnNode& startNode = *boundIt++;
+    const EdnNode& endNode = *boundIt++;
+    const EdnNode* stepNode = boundIt != headNode.values.end() ? &*boundIt : nullptr;
+    llvm::Value* start = convertValue(startNode, this->codegenExpr(startNode, context, builder), typeOf(startNode), varType, builder);
+    llvm::Value* end = convertValue(endNode, this->codegenExpr(endNode, context, builder), typeOf(endNode), varType, builder);
+    llvm::Value* step = llvm::ConstantInt::get(varType->llvmType, 1);
+    if (stepNode) {
+        step = convertValue(*stepNode, this->codegenExpr(*stepNode, context, builder), typeOf(*stepNode), varType, builder);
+    }
+    const std::string& direction = node.metadata.at("direction");
+    llvm::Function* function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock* condBB = llvm::BasicBlock::Create(context, "for.cond", function);
+    llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(context, "for.body", function);
+    llvm::BasicBlock* latchBB = llvm::BasicBlock::Create(context, "for.latch", function);
+    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(context, "for.after", function);
+    symbols.pushScope();
+    llvm::AllocaInst* var = createEntryAlloca(builder, varType->llvmType, varNode.value);
+    symbols.declare(varNode.value, var, varType);
+    builder.CreateStore(start, var);
     builder.CreateBr(condBB);
+    // Condition block
+    builder.SetInsertPoint(condBB);
+    llvm::Value* current = builder.CreateLoad(varType->llvmType, var, varNode.value);
+    llvm::Value* condVal = nullptr;
+    if (direction == "up") {
+        condVal = builder.CreateICmpSLT(current, end, "for.test");
+    } else if (direction == "down") {
+        condVal = builder.CreateICmpSGT(current, end, "for.test");
+    } else {
+        // The step's sign picks the test; a zero step runs no iterations
+        llvm::Value* zero = llvm::ConstantInt::get(varType->llvmType, 0);
+        llvm::Value* up = builder.CreateAnd(builder.CreateICmpSGT(step, zero), builder.CreateICmpSLT(current, end));
+        condVal = builder.CreateSelect(builder.CreateICmpSLT(step, zero), builder.CreateICmpSGT(current, end), up, "for.test");
+    }
+    auto condBr = builder.CreateCondBr(condVal, bodyBB, afterBB);
+    std::string bodyKey = profileKey("for", node, "body");
+    std::string exitKey = profileKey("for", node, "exit");
+    setBranchWeights(condBr, profileCount(bodyKey), profileCount(exitKey));
+    // Body block
+    builder.SetInsertPoint(bodyBB);
+    emitProfileCounter(bodyKey, builder);
+    loopTargets.push_back({latchBB, afterBB});
+    this->codegenExpr(bodyNode, context, builder);
+    loopTargets.pop_back();
+    builder.CreateBr(latchBB);
+    // Latch block: the only backedge
+    builder.SetInsertPoint(latchBB);
+    current = builder.CreateLoad(varType->llvmType, var, varNode.value);
+    builder.CreateStore(builder.CreateNSWAdd(current, step, "for.next"), var);
+    setLoopMetadata(builder.CreateBr(condBB), node);
+    symbols.popScope();
     // After block
     builder.SetInsertPoint(afterBB);
-    // Return 0.0 as the value of the while loop (could be changed to last body value if desired)
-    return llvm::ConstantFP::get(builder.getDoubleTy(), 0.0);
+    emitProfileCounter(exitKey, builder);
+    return nullptr;
 }
 
+// (break) / (continue): leave or restart the innermost loop. Code after it in the
+// same block is unreachable and goes into a block with no predecessors.
+llvm::Value* Engine::codegenLoopExit(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    const std::string& op = node.values.front().value;
+    if (loopTargets.empty()) throw YeetCompileException(node, fmt::format("{} outside of a loop", op), filePath, __FILE__, __LINE__);
+    const LoopTargets& loop = loopTargets.back();
+    builder.CreateBr(op == "break" ? loop.breakBB : loop.continueBB);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, op + ".dead", builder.GetInsertBlock()->getParent()));
+    return nullptr;
+}
+
+// Marks the branch as a loop's backedge with its own llvm.loop node, carrying the
+// loop's hints: (while test :unroll 4 :vectorize 8 :interleave 2 body). :unroll 1
+// and :vectorize 1 turn the transformation off, :unroll full asks for a full unroll.
+void Engine::setLoopMetadata(llvm::BranchInst* backedge, const edn::EdnNode& node) {
+    llvm::LLVMContext& context = backedge->getContext();
+    auto i32 = [&](uint64_t value) {
+        return llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), value));
+    };
+    auto property = [&](const char* name, llvm::Metadata* value = nullptr) {
+        std::vector<llvm::Metadata*> operands = {llvm::MDString::get(context, name)};
+        if (value) operands.push_back(value);
+        return llvm::MDNode::get(context, operands);
+    };
+    llvm::SmallVector<llvm::Metadata*, 8> properties;
+    // Placeholder for the self reference every llvm.loop node starts with
+    properties.push_back(nullptr);
+    if (options.remarks) {
+        properties.push_back(loopLocation(backedge->getFunction(), node));
+    }
+    // Hints sit between the loop head and the body
+    for (auto it = std::next(node.values.begin(), 2); std::next(it) != node.values.end(); std::advance(it, 2)) {
+        const std::string& hint = it->value;
+        const edn::EdnNode& valueNode = *std::next(it);
+        if (hint == ":unroll" && valueNode.value == "full") {
+            properties.push_back(property("llvm.loop.unroll.full"));
+            continue;
+        }
+        uint64_t count = std::stoull(valueNode.value);
+        if (hint == ":unroll") {
+            properties.push_back(count == 1 ? property("llvm.loop.unroll.disable") : property("llvm.loop.unroll.count", i32(count)));
+        } else if (hint == ":vectorize") {
+            properties.push_back(property("llvm.loop.vectorize.width", i32(count)));
+            if (count > 1) {
+                properties.push_back(property("llvm.loop.vectorize.enable", llvm::ConstantAsMetadata::get(llvm::ConstantInt::getTrue(context))));
+            }
+        } else if (hint == ":interleave") {
+            properties.push_back(property("llvm.loop.interleave.count", i32(count)));
+        }
+    }
+    llvm::MDNode* loopID = llvm::MDNode::getDistinct(context, properties);
+    loopID->replaceOperandWith(0, loopID);
+    backedge->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+}
 
 // Main dispatcher
 llvm::Value* Engine::codegenExpr(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
@@ -692,10 +1203,14 @@ llvm::Value* Engine::codegenExpr(const edn::EdnNode& node, llvm::LLVMContext& co
             return codegenInt(node, builder);
         case EdnFloat:
             return codegenFloat(node, builder);
+        case EdnBool:
+            return builder.getInt1(node.value == "true");
         case EdnSymbol:
             return codegenSymbol(node, builder);
         case EdnList:
             return codegenList(node, context, builder);
+        case EdnVector:
+            return codegenArrayLiteral(node, context, builder);
         default:
             throw YeetCompileException(node, "Unsupported expression", filePath, __FILE__, __LINE__);
     }
@@ -703,9 +1218,15 @@ llvm::Value* Engine::codegenExpr(const edn::EdnNode& node, llvm::LLVMContext& co
 
 // Helper for cond special form
 llvm::Value* Engine::codegenCond(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenCond", [&] { return traceDetail(node); });
     using namespace edn;
     // (cond (test1 expr1) (test2 expr2) ... (else exprN))
     if (node.values.size() < 2) throw YeetCompileException(node, "cond requires at least one clause", filePath, __FILE__, __LINE__);
+    TypeRef resultType = typeOf(node);
+    // Per-arm counters need the arms in blocks of their own
+    if (!resultType->isVoid() && options.profileGenerate.empty() && isSelectable(node)) {
+        return this->codegenCondSelect(node, context, builder);
+    }
     llvm::Function* function = builder.GetInsertBlock()->getParent();
     llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(context, "cond.after", function);
     llvm::PHINode* phi = nullptr;
@@ -713,6 +1234,13 @@ llvm::Value* Engine::codegenCond(const edn::EdnNode& node, llvm::LLVMContext& co
     std::vector<std::pair<const edn::EdnNode*, llvm::BasicBlock*>> clauses;
     llvm::BasicBlock* dispatchBB = builder.GetInsertBlock();
     size_t lastDispatched = 0;
+    // Profiled arm counts, remainingCounts[i] is how often arm i or any later arm ran
+    std::vector<uint64_t> remainingCounts(node.values.size(), 0);
+    if (!profileCounts.empty()) {
+        for (size_t i = node.values.size() - 1; i-- > 0;) {
+            remainingCounts[i] = remainingCounts[i + 1] + profileCount(profileKey("cond", node, std::to_string(i)));
+        }
+    }
     auto it = std::next(node.values.begin());
     for (; it != node.values.end(); ++it) {
         clauses.emplace_back(&(*it), llvm::BasicBlock::Create(context, "cond.clause", function));
@@ -726,6 +1254,7 @@ llvm::Value* Engine::codegenCond(const edn::EdnNode& node, llvm::LLVMContext& co
         llvm::Value* testVal = nullptr;
         if (clause->values.size() == 2) {
             testVal = this->codegenExpr(*testNode, context, builder);
+            testVal = convertValue(*testNode, testVal, typeOf(*testNode), types->boolType(), builder);
         }
         if (clause->values.size() == 1 || (testNode && testNode->type == edn::EdnSymbol && testNode->value == "else") || std::next(it) == node.values.end()) {
             builder.CreateBr(clauses.back().second);
@@ -734,95 +1263,232 @@ llvm::Value* Engine::codegenCond(const edn::EdnNode& node, llvm::LLVMContext& co
             break;
         } else {
             llvm::BasicBlock* nextBB = llvm::BasicBlock::Create(context, "cond.clause", function);
-            builder.CreateCondBr(testVal, clauses.back().second, nextBB);
+            auto clauseBr = builder.CreateCondBr(testVal, clauses.back().second, nextBB);
+            size_t arm = clauses.size() - 1;
+            setBranchWeights(clauseBr, remainingCounts[arm] - remainingCounts[arm + 1], remainingCounts[arm + 1]);
             dispatchBB = nextBB;
             lastDispatched = clauses.size();
         }
     }
-    // Now fill in each clause block (only up to lastDispatched)
-    phi = llvm::PHINode::Create(builder.getDoubleTy(), lastDispatched, "condresult", afterBB);
+    // Now fill in each clause block (only up to lastDispatched), a statement cond has no result
+    if (!resultType->isVoid()) {
+        phi = llvm::PHINode::Create(resultType->llvmType, lastDispatched, "condresult", afterBB);
+    }
     for (size_t i = 0; i < lastDispatched; ++i) {
         llvm::BasicBlock* clauseBB = clauses[i].second;
         builder.SetInsertPoint(clauseBB);
+        emitProfileCounter(profileKey("cond", node, std::to_string(i)), builder);
         const edn::EdnNode* clause = clauses[i].first;
         auto exprIt = clause->values.end();
         --exprIt;
         const edn::EdnNode& exprNode = *exprIt;
+        symbols.pushScope();
         llvm::Value* exprVal = this->codegenExpr(exprNode, context, builder);
-        llvm::Value* castVal = exprVal;
-        if (exprVal->getType()->isIntegerTy()) {
-            castVal = builder.CreateSIToFP(exprVal, builder.getDoubleTy(), "intToDouble");
-        } else if (exprVal->getType()->isFloatTy() && !exprVal->getType()->isDoubleTy()) {
-            castVal = builder.CreateFPExt(exprVal, builder.getDoubleTy(), "floatToDouble");
+        symbols.popScope();
+        if (phi) {
+            exprVal = convertValue(exprNode, exprVal, typeOf(exprNode), resultType, builder);
         }
+        // The arm may have ended in another block (nested cond/while)
+        clauseBB = builder.GetInsertBlock();
         builder.CreateBr(afterBB);
-        phi->addIncoming(castVal, clauseBB);
+        if (phi) {
+            phi->addIncoming(exprVal, clauseBB);
+        }
     }
     builder.SetInsertPoint(afterBB);
     return phi;
 }
 
+// (select test a b): both values are evaluated, the test picks one without a branch.
+// A mask test picks lane by lane.
+llvm::Value* Engine::codegenSelect(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenSelect", [&] { return traceDetail(node); });
+    if (node.values.size() != 4) throw YeetCompileException(node, "select requires a test and two values", filePath, __FILE__, __LINE__);
+    TypeRef resultType = typeOf(node);
+    const edn::EdnNode& testNode = *std::next(node.values.begin());
+    const edn::EdnNode& lhsNode = *std::next(node.values.begin(), 2);
+    const edn::EdnNode& rhsNode = node.values.back();
+    llvm::Value* testVal = this->codegenExpr(testNode, context, builder);
+    if (!typeOf(testNode)->isVector()) {
+        testVal = convertValue(testNode, testVal, typeOf(testNode), types->boolType(), builder);
+    }
+    llvm::Value* lhsVal = this->codegenExpr(lhsNode, context, builder);
+    lhsVal = convertValue(lhsNode, lhsVal, typeOf(lhsNode), resultType, builder);
+    llvm::Value* rhsVal = this->codegenExpr(rhsNode, context, builder);
+    rhsVal = convertValue(rhsNode, rhsVal, typeOf(rhsNode), resultType, builder);
+    return builder.CreateSelect(testVal, lhsVal, rhsVal, "select");
+}
+
+// (case expr (k1 body) ((k2 k3) body) ... (else body)): one SwitchInst, which the
+// backend turns into a jump table or a binary search. Arm i is profiled as
+// case:<line>:<column>:<i>, falling through an else-less case as ...:default.
+llvm::Value* Engine::codegenCase(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenCase", [&] { return traceDetail(node); });
+    TypeRef resultType = typeOf(node);
+    const edn::EdnNode& subjectNode = *std::next(node.values.begin());
+    auto subjectType = llvm::cast<llvm::IntegerType>(typeOf(subjectNode)->llvmType);
+    llvm::Value* subject = this->codegenExpr(subjectNode, context, builder);
+    llvm::Function* function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(context, "case.after", function);
+    const edn::EdnNode& lastClause = node.values.back();
+    bool hasElse = lastClause.values.front().type == edn::EdnSymbol && lastClause.values.front().value == "else";
+    size_t armCount = node.values.size() - 2;
+    std::vector<llvm::BasicBlock*> armBlocks;
+    for (size_t i = 0; i < armCount; ++i) {
+        armBlocks.push_back(llvm::BasicBlock::Create(context, hasElse && i + 1 == armCount ? "case.else" : "case.arm", function, afterBB));
+    }
+    std::string defaultKey = profileKey("case", node, hasElse ? std::to_string(armCount - 1) : "default");
+    llvm::BasicBlock* defaultBB = hasElse ? armBlocks.back() : afterBB;
+    if (!hasElse && !options.profileGenerate.empty()) {
+        // A block of its own to count the fall through in
+        defaultBB = llvm::BasicBlock::Create(context, "case.default", function, afterBB);
+        llvm::IRBuilder<> defaultBuilder(defaultBB);
+        emitProfileCounter(defaultKey, defaultBuilder);
+        defaultBuilder.CreateBr(afterBB);
+    }
+    auto switchInst = builder.CreateSwitch(subject, defaultBB, armCount);
+    // Successor weights: the default first, then every key in the order it was added
+    std::vector<uint64_t> weights = {profileCount(defaultKey)};
+    auto clauseIt = std::next(node.values.begin(), 2);
+    for (size_t i = 0; i < armCount; ++i, ++clauseIt) {
+        const edn::EdnNode& keysNode = clauseIt->values.front();
+        if (hasElse && i + 1 == armCount) break;
+        std::vector<const edn::EdnNode*> keys;
+        if (keysNode.type == edn::EdnList) {
+            for (const auto& key : keysNode.values) keys.push_back(&key);
+        } else {
+            keys.push_back(&keysNode);
+        }
+        for (const edn::EdnNode* key : keys) {
+            switchInst->addCase(llvm::ConstantInt::getSigned(subjectType, std::stoll(key->value)), armBlocks[i]);
+            weights.push_back(profileCount(profileKey("case", node, std::to_string(i))) / keys.size());
+        }
+    }
+    setBranchWeights(switchInst, weights);
+    llvm::PHINode* phi = nullptr;
+    if (!resultType->isVoid()) {
+        phi = llvm::PHINode::Create(resultType->llvmType, armCount, "caseresult", afterBB);
+    }
+    clauseIt = std::next(node.values.begin(), 2);
+    for (size_t i = 0; i < armCount; ++i, ++clauseIt) {
+        builder.SetInsertPoint(armBlocks[i]);
+        emitProfileCounter(profileKey("case", node, std::to_string(i)), builder);
+        const edn::EdnNode& exprNode = clauseIt->values.back();
+        symbols.pushScope();
+        llvm::Value* exprVal = this->codegenExpr(exprNode, context, builder);
+        symbols.popScope();
+        if (phi) {
+            exprVal = convertValue(exprNode, exprVal, typeOf(exprNode), resultType, builder);
+        }
+        // The arm may have ended in another block (nested cond/while)
+        llvm::BasicBlock* armEnd = builder.GetInsertBlock();
+        builder.CreateBr(afterBB);
+        if (phi) {
+            phi->addIncoming(exprVal, armEnd);
+        }
+    }
+    builder.SetInsertPoint(afterBB);
+    return phi;
+}
+
+// Cheap enough to evaluate whether or not its arm is taken, and free of side
+// effects: literals, variables and arithmetic or comparisons on them. Division
+// is left out, it can trap. budget is the number of operations still allowed.
+static bool isSpeculatable(const edn::EdnNode& node, int& budget) {
+    switch (node.type) {
+        case edn::EdnInt:
+        case edn::EdnFloat:
+        case edn::EdnBool:
+        case edn::EdnSymbol:
+            return true;
+        case edn::EdnList:
+            break;
+        default:
+            return false;
+    }
+    if (node.values.size() != 3 || node.values.front().type != edn::EdnSymbol || --budget < 0) return false;
+    static const std::unordered_set<std::string> speculatableOps = {"+", "-", "*", "==", "!=", "<", "<=", ">", ">="};
+    if (!speculatableOps.count(node.values.front().value)) return false;
+    return isSpeculatable(*std::next(node.values.begin()), budget) && isSpeculatable(node.values.back(), budget);
+}
+
+// A cond whose tests and arms are all speculatable and take at most a few
+// operations together. Scalar results only, a select of aggregates is no cheaper.
+bool Engine::isSelectable(const edn::EdnNode& node) {
+    TypeRef resultType = typeOf(node);
+    if (!resultType->isNumeric() && !resultType->isPointer()) return false;
+    int budget = 4;
+    for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+        for (const auto& part : it->values) {
+            if (!isSpeculatable(part, budget)) return false;
+        }
+    }
+    return true;
+}
+
+// Branchless cond: every reachable test and arm is evaluated in order, then the
+// arms are chained into selects from the last one back
+llvm::Value* Engine::codegenCondSelect(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenCondSelect", [&] { return traceDetail(node); });
+    TypeRef resultType = typeOf(node);
+    std::vector<std::pair<llvm::Value*, llvm::Value*>> arms;
+    for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+        const edn::EdnNode& testNode = it->values.front();
+        const edn::EdnNode& exprNode = it->values.back();
+        bool unconditional = it->values.size() == 1 || (testNode.type == edn::EdnSymbol && testNode.value == "else") || std::next(it) == node.values.end();
+        llvm::Value* testVal = nullptr;
+        if (!unconditional) {
+            testVal = this->codegenExpr(testNode, context, builder);
+            testVal = convertValue(testNode, testVal, typeOf(testNode), types->boolType(), builder);
+        }
+        llvm::Value* exprVal = this->codegenExpr(exprNode, context, builder);
+        arms.emplace_back(testVal, convertValue(exprNode, exprVal, typeOf(exprNode), resultType, builder));
+        if (unconditional) break;
+    }
+    std::vector<uint64_t> remainingCounts(arms.size() + 1, 0);
+    if (!profileCounts.empty()) {
+        for (size_t i = arms.size(); i-- > 0;) {
+            std::string key = profileKey("cond", node, std::to_string(i));
+            recordProfileSite(key, builder);
+            remainingCounts[i] = remainingCounts[i + 1] + profileCount(key);
+        }
+    }
+    llvm::Value* result = arms.back().second;
+    for (size_t i = arms.size() - 1; i-- > 0;) {
+        result = builder.CreateSelect(arms[i].first, arms[i].second, result, "condsel");
+        if (auto select = llvm::dyn_cast<llvm::SelectInst>(result)) {
+            setBranchWeights(select, remainingCounts[i] - remainingCounts[i + 1], remainingCounts[i + 1]);
+        }
+    }
+    return result;
+}
+
 llvm::Value* Engine::codegenBinop(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder)
 {
+    llvm::TimeTraceScope timeScope("codegenBinop", [&] { return traceDetail(node); });
     using namespace edn;
     const EdnNode& opNode = node.values.front();
     std::string op = opNode.value;
     if (node.values.size() != 3) throw YeetCompileException(node, "Expected two operands", filePath, __FILE__, __LINE__);
     auto lhsIt = ++node.values.begin();
     auto rhsIt = ++++node.values.begin();
+    // Both operands are converted to the type the checker picked for the operation
+    TypeRef operandType = resolveType(node, node.metadata.at("operandType"));
     llvm::Value* lhs = this->codegenExpr(*lhsIt, context, builder);
     llvm::Value* rhs = this->codegenExpr(*rhsIt, context, builder);
-    // Use type info from symbolTable if available
-    std::string lhsType = "int32";
-    std::string rhsType = "int32";
-    if (lhsIt->type == EdnSymbol) {
-        auto it = llvmSymbolTable.find(lhsIt->value);
-        if (it != llvmSymbolTable.end()) lhsType = it->second.second;
-    } else if (lhsIt->type == EdnFloat) {
-        lhsType = "float64";
-    }
-    if (rhsIt->type == EdnSymbol) {
-        auto it = llvmSymbolTable.find(rhsIt->value);
-        if (it != llvmSymbolTable.end()) rhsType = it->second.second;
-    } else if (rhsIt->type == EdnFloat) {
-        rhsType = "float64";
-    }
-
-    llvm::Type* lhsLLVMType = getLLVMType(node, lhsType, builder);
-    llvm::Type* rhsLLVMType = getLLVMType(node, rhsType, builder);
-
-    // Promote types for binops: if either is float, promote both to float64; else promote to largest int
-    bool lhsIsFloat = lhsLLVMType->isFloatingPointTy();
-    bool rhsIsFloat = rhsLLVMType->isFloatingPointTy();
-    bool isFloatOp = lhsIsFloat || rhsIsFloat;
-
-    // For integer binops, promote to largest bitwidth
-    unsigned intBitwidth = std::max(lhsLLVMType->getIntegerBitWidth(), rhsLLVMType->getIntegerBitWidth());
-    llvm::Type* promotedIntType = nullptr;
-    if (!isFloatOp) {
-        if (intBitwidth == 8) promotedIntType = builder.getInt8Ty();
-        else if (intBitwidth == 16) promotedIntType = builder.getInt16Ty();
-        else if (intBitwidth == 32) promotedIntType = builder.getInt32Ty();
-        else if (intBitwidth == 64) promotedIntType = builder.getInt64Ty();
-        else throw YeetCompileException(node, fmt::format("Unsupported integer bitwidth: {}", intBitwidth), filePath, __FILE__, __LINE__);
-        if (lhsLLVMType != promotedIntType) lhs = builder.CreateIntCast(lhs, promotedIntType, true, "intCastL");
-        if (rhsLLVMType != promotedIntType) rhs = builder.CreateIntCast(rhs, promotedIntType, true, "intCastR");
-    } else {
-        // Promote both to float64 for now
-        if (!lhsIsFloat) lhs = builder.CreateSIToFP(lhs, builder.getDoubleTy(), "intToDoubleL");
-        if (!rhsIsFloat) rhs = builder.CreateSIToFP(rhs, builder.getDoubleTy(), "intToDoubleR");
-        lhsLLVMType = builder.getDoubleTy();
-        rhsLLVMType = builder.getDoubleTy();
-    }
+    lhs = convertValue(*lhsIt, lhs, typeOf(*lhsIt), operandType, builder);
+    rhs = convertValue(*rhsIt, rhs, typeOf(*rhsIt), operandType, builder);
+    // Vector operands go lane by lane through the same instructions
+    bool isFloatOp = (operandType->isVector() ? operandType->element : operandType)->isFloat();
 
     if (op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=") {
         if (isFloatOp) {
-            if (op == "==") return builder.CreateUIToFP(builder.CreateFCmpUEQ(lhs, rhs, "cmptmp"), builder.getDoubleTy());
-            if (op == "!=") return builder.CreateUIToFP(builder.CreateFCmpUNE(lhs, rhs, "cmptmp"), builder.getDoubleTy());
-            if (op == "<")  return builder.CreateUIToFP(builder.CreateFCmpULT(lhs, rhs, "cmptmp"), builder.getDoubleTy());
-            if (op == "<=") return builder.CreateUIToFP(builder.CreateFCmpULE(lhs, rhs, "cmptmp"), builder.getDoubleTy());
-            if (op == ">")  return builder.CreateUIToFP(builder.CreateFCmpUGT(lhs, rhs, "cmptmp"), builder.getDoubleTy());
-            if (op == ">=") return builder.CreateUIToFP(builder.CreateFCmpUGE(lhs, rhs, "cmptmp"), builder.getDoubleTy());
+            if (op == "==") return builder.CreateFCmpUEQ(lhs, rhs, "cmptmp");
+            if (op == "!=") return builder.CreateFCmpUNE(lhs, rhs, "cmptmp");
+            if (op == "<")  return builder.CreateFCmpULT(lhs, rhs, "cmptmp");
+            if (op == "<=") return builder.CreateFCmpULE(lhs, rhs, "cmptmp");
+            if (op == ">")  return builder.CreateFCmpUGT(lhs, rhs, "cmptmp");
+            if (op == ">=") return builder.CreateFCmpUGE(lhs, rhs, "cmptmp");
         } else {
             if (op == "==") return builder.CreateICmpEQ(lhs, rhs, "cmptmp");
             if (op == "!=") return builder.CreateICmpNE(lhs, rhs, "cmptmp");
@@ -850,24 +1516,22 @@ llvm::Value* Engine::codegenBinop(const edn::EdnNode& node, llvm::LLVMContext& c
 
 // Helper: Define a struct type
 void Engine::defineStructType(const edn::EdnNode& node, const std::vector<std::pair<std::string, std::string>>& fields, llvm::IRBuilder<>& builder, llvm::LLVMContext& context) {
-    // 1 Check if struct type already exists
+    llvm::TimeTraceScope timeScope("defineStructType", [&] { return traceDetail(node); });
+    // 1 Resolve field types
     auto name = node.value;
-    if (llvmStructTypes.find(name) != llvmStructTypes.end()) {  
-        throw YeetCompileException(edn::EdnNode{}, fmt::format("Struct type already defined: {}", name), filePath, __FILE__, __LINE__);
-    }
-    yeetStructTable[name] = fields;
-
-    // 2 Build LLVM representation
-    std::vector<llvm::Type*> llvmFields;
+    std::vector<std::pair<std::string, TypeRef>> fieldTypes;
     for (const auto& [fieldName, fieldType] : fields) {
-        llvmFields.push_back(getLLVMType(node, fieldType, builder));
+        fieldTypes.emplace_back(fieldName, resolveType(node, fieldType));
+    }
+    // 2 Register the type, which also builds its LLVM representation
+    if (!types->defineStruct(name, std::move(fieldTypes))) {
+        throw YeetCompileException(node, fmt::format("Struct type already defined: {}", name), filePath, __FILE__, __LINE__);
     }
-    auto structType = llvm::StructType::create(context, llvmFields, name);
-    llvmStructTypes[name] = structType;
 }
 
 llvm::Value* Engine::codegenStructAccess(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder)
 {
+    llvm::TimeTraceScope timeScope("codegenStructAccess", [&] { return traceDetail(node); });
     // Expect: (. target :field)
     if (node.values.size() != 3)
         throw YeetCompileException(node, "Struct field access must be of form (. target :field)", filePath, __FILE__, __LINE__);
@@ -884,41 +1548,23 @@ llvm::Value* Engine::codegenStructAccess(const edn::EdnNode& node, llvm::LLVMCon
     const edn::EdnNode& fieldNode = *it;
     if (fieldNode.type != edn::EdnKeyword)
         throw YeetCompileException(fieldNode, "Struct field must be a keyword", filePath, __FILE__, __LINE__);
-    auto symbolIt = llvmSymbolTable.find(structTargetNode.value);
-    if (symbolIt == llvmSymbolTable.end())
-        throw YeetCompileException(structTargetNode, fmt::format("Struct target not defined: {}", structTargetNode.value), filePath, __FILE__, __LINE__);
-    std::string structName = symbolIt->second.second;
-    std::string fieldName = fieldNode.value.substr(1); // Remove leading ':'
-    auto yeetStructValueIt = yeetStructTable.find(structName);
-    if (yeetStructValueIt == yeetStructTable.end())
-        throw YeetCompileException(structTargetNode, fmt::format("Struct not defined: {}", structName), filePath, __FILE__, __LINE__);
-    auto& yeetStructType = yeetStructValueIt->second;
-    // Type check: must be pointer to struct
-    auto structTypePointer = symbolIt->second.first;
-    // lookup llvm struct type definition
-    auto llvmStructTypeDefIt = llvmStructTypes.find(structName);
-    if (llvmStructTypeDefIt == llvmStructTypes.end())
-        throw YeetCompileException(structTargetNode, fmt::format("Struct type not defined: {}", structName), filePath, __FILE__, __LINE__);
-    auto llvmStructTypeDef = llvmStructTypeDefIt->second;
-    // Lookup field index in struct type
-    auto fieldIndexIt = yeetStructType.begin();
-    for (; fieldIndexIt != yeetStructType.end(); ++fieldIndexIt) {
-        if (fieldIndexIt->first == fieldName) break;
-    }
-    if (fieldIndexIt == yeetStructType.end())
-        throw YeetCompileException(fieldNode, fmt::format("Field not a member of struct: {} in struct {}", fieldName, structName), filePath, __FILE__, __LINE__);
-    auto fieldIndexId = std::distance(yeetStructType.begin(), fieldIndexIt);
-    auto fieldType = fieldIndexIt->second;
     // Access field value
-    auto gep = builder.CreateStructGEP(llvmStructTypeDef, structTypePointer, fieldIndexId);
-    return builder.CreateLoad(getLLVMType(node, fieldType, builder), gep, fieldName);
+    auto [gep, field] = structFieldAddress(structTargetNode, fieldNode, builder);
+    return builder.CreateLoad(field->type->llvmType, gep, field->name);
 }
 
-
-std::string Engine::dumpModule()
+// Address of target's field: one symbol lookup, then one hashed lookup in the struct's layout
+std::pair<llvm::Value*, const StructField*> Engine::structFieldAddress(const edn::EdnNode& structTargetNode, const edn::EdnNode& fieldNode, llvm::IRBuilder<>& builder)
 {
-    std::string output;
-    llvm::raw_string_ostream os(output);
-    mod->print(os, nullptr);
-    return os.str();
-}
\ No newline at end of file
+    SymbolTable::Symbol* symbol = symbols.lookup(structTargetNode.value);
+    if (!symbol)
+        throw YeetCompileException(structTargetNode, fmt::format("Struct target not defined: {}", structTargetNode.value), filePath, __FILE__, __LINE__);
+    llvm::Value* structPtr = symbol->value;
+    TypeRef structType = symbol->type;
+    if (!structType->isStruct())
+        throw YeetCompileException(structTargetNode, fmt::format("Struct not defined: {}", structType->name), filePath, __FILE__, __LINE__);
+    const StructField* field = structType->field(fieldNode.value.substr(1)); // Remove leading ':'
+    if (!field)
+        throw YeetCompileException(fieldNode, fmt::format("Field not a member of struct: {} in struct {}", fieldNode.value.substr(1), structType->name), filePath, __FILE__, __LINE__);
+    return {builder.CreateStructGEP(structType->llvmType, structPtr, field->index), field};
+}
@@ -1,21 +1,30 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <format>
 #include <string>
+#include <thread>
+#include <mutex>
 
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/Timer.h>
 
 #include <fmt/format.h>
 
 #include "edn/edn.hpp"
+#include "typecheck.hpp"
+#include "types.hpp"
+#include "symbols.hpp"
 
 namespace yeet
 {
@@ -47,30 +56,118 @@ namespace yeet
         int engineLine = -1;
     };
 
+    // Detail for trace spans: where in the .yeet file the form starts
+    std::string traceDetail(const edn::EdnNode& node);
+
+    // Artifact written by --emit
+    enum class EmitKind {
+        None,
+        IR,
+        Bitcode,
+        Assembly,
+        Object
+    };
+
+    // Compiler configuration, filled from the command line
+    struct EngineOptions {
+        // Pass pipeline level for the whole module (0-3)
+        unsigned optLevel = 0;
+        // Tiered compilation: defn functions start at -O0 behind a stub and are
+        // recompiled at -O3 on a background thread once they get hot
+        bool tiered = false;
+        uint64_t tierThreshold = 1000;
+        // Profile guided optimization: write counters to / read counters from these paths
+        std::string profileGenerate;
+        std::string profileUse;
+        // Instruction set (CPU whose features are enabled) and scheduling CPU, empty means the host
+        std::string march;
+        std::string mcpu;
+        bool printTarget = false;
+        // Artifact output, "-" or empty writes text artifacts to stdout
+        EmitKind emit = EmitKind::None;
+        std::string outputPath;
+        // One variant per CPU of every defn in emitted artifacts
+        std::vector<std::string> multiversion;
+        // Per phase and per pass wall/CPU times on stderr
+        bool timeReport = false;
+        // Chrome trace-event JSON of every compile phase, codegen form and pass
+        std::string tracePath;
+        // Trace events shorter than this many microseconds are dropped
+        unsigned traceGranularity = 0;
+        // Yeet level constant folding, dead code removal and CSE before codegen
+        bool astOpt = true;
+        // Per function instruction/block/alloca/load/store/cast/call counts before and after optimization
+        bool stats = false;
+        // Loop unroll/vectorize remarks on stderr, including whether loop hints were honored
+        bool remarks = false;
+        // Array and slice accesses check their index and exit with an error when it is out of range
+        bool boundsChecks = true;
+    };
+
     class Engine
     {
     private:
         std::unique_ptr<llvm::orc::LLJIT> jit;
+        // Host or --march target, every optimizer run builds its own TargetMachine from this
+        std::optional<llvm::orc::JITTargetMachineBuilder> targetBuilder;
         std::unique_ptr<llvm::LLVMContext> context;
         std::unique_ptr<llvm::Module> mod;
         std::string filePath;
+        EngineOptions options;
+
+    private:
+        // Tiered compilation state
+        // Tier-0 module snapshot the hot functions are recompiled from
+        std::string tierBitcode;
+        // Tier id -> function name, ids are baked into the tier-up calls
+        std::vector<std::string> tieredFunctions;
+        std::vector<std::thread> tierThreads;
+        std::mutex tierMutex;
 
     private:
-        // LLVM Variable/Struct definitions
-        // Symbol table: name -> (alloca, type string)
-        std::unordered_map<std::string, std::pair<llvm::Value*, std::string>> llvmSymbolTable;
-        std::map<std::string, llvm::StructType*> llvmStructTypes;
+        // Profile guided optimization state
+        // Counter index -> site key, the counter global is __yeet_prof_<index>
+        std::vector<std::string> profileKeys;
+        // Site key -> count loaded from --profile-use
+        std::unordered_map<std::string, uint64_t> profileCounts;
+        // Site key -> name of the function the site was generated in
+        std::unordered_map<std::string, std::string> profileSiteFunctions;
+
+    private:
+        // --time-report: one timer per compile phase, created on first use
+        std::unique_ptr<llvm::TimerGroup> phaseTimers;
+        std::map<std::string, std::unique_ptr<llvm::Timer>> phaseTimerTable;
+
+    private:
+        // LLVM Variable definitions
+        // Scoped symbol table: name -> (alloca, type)
+        SymbolTable symbols;
+        // Innermost loop last: where continue and break branch to
+        struct LoopTargets {
+            llvm::BasicBlock* continueBB;
+            llvm::BasicBlock* breakBB;
+        };
+        std::vector<LoopTargets> loopTargets;
         
     private:
-        // Structure Type Definitions
-        std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> yeetStructTable;
-        // Function table for lazy generation / TODO generic function handling
-        std::unordered_map<std::string, std::pair<std::vector<std::pair<std::string, std::string>>, edn::EdnNode>> yeetFunctionTable;
-        // Function return types: name -> type string
-        std::unordered_map<std::string, std::string> yeetFunctionReturnTypes;
+        // Builtin, pointer and struct types of the module being compiled
+        std::unique_ptr<TypeRegistry> types;
+        // What calc returns, see createEntryFunction
+        TypeRef entryType = nullptr;
+        // A defn declared up front: its signature, the llvm::Function calls are made
+        // against, and the form the body is generated from once calc is done
+        struct FunctionInfo {
+            std::vector<std::pair<std::string, TypeRef>> params;
+            TypeRef returnType = nullptr;
+            const edn::EdnNode* node = nullptr;
+            llvm::Function* function = nullptr;
+        };
+        std::unordered_map<std::string, FunctionInfo> yeetFunctionTable;
+        // Declaration order, bodies are generated in it
+        std::vector<std::string> yeetFunctionOrder;
         
     public:
-        Engine(const std::string& filePath);
+        Engine(const std::string& filePath, const EngineOptions& options = {});
         ~Engine();
 
         void run(std::string& s);
@@ -79,12 +176,17 @@ namespace yeet
 
     private:
         void initializeLLVM();
+        llvm::Function* createEntryFunction(const edn::EdnNode& root, llvm::Function*& mainFunc);
         llvm::Value* codegenInt(const edn::EdnNode& node, llvm::IRBuilder<>& builder);
         llvm::Value* codegenFloat(const edn::EdnNode& node, llvm::IRBuilder<>& builder);
         llvm::Value* codegenSymbol(const edn::EdnNode& node, llvm::IRBuilder<>& builder);
         llvm::Value* codegenList(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenExpr(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenCond(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        bool isSelectable(const edn::EdnNode& node);
+        llvm::Value* codegenCondSelect(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenSelect(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenCase(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenAssign(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenAssignPointer(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenAssignLiteral(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
@@ -95,15 +197,98 @@ namespace yeet
         llvm::Value* codegenDereference(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenBinop(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         llvm::Value* codegenWhile(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
-        llvm::Value* codegenDefn(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenFor(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenLoopExit(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        void setLoopMetadata(llvm::BranchInst* backedge, const edn::EdnNode& node);
         llvm::Value* codegenCall(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
         
+        std::pair<llvm::Value*, const StructField*> structFieldAddress(const edn::EdnNode& structTargetNode, const edn::EdnNode& fieldNode, llvm::IRBuilder<>& builder);
+        void declareGlobals(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        void declareStruct(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        void declareFunction(const edn::EdnNode& node);
+        void codegenFunctionBody(FunctionInfo& function, llvm::LLVMContext& context);
         void defineStructType(const edn::EdnNode& node, const std::vector<std::pair<std::string, std::string>>& fields, llvm::IRBuilder<>& builder, llvm::LLVMContext& context);
         // Set a struct field value (mutate in place)
 
     private:
-        llvm::Type* getLLVMType(const edn::EdnNode& node, const std::string& typeStr, llvm::IRBuilder<>& builder);
+        // Tiered compilation (tiering.cpp)
+        void emitTierPrologue(llvm::Function* func, llvm::IRBuilder<>& builder);
+        llvm::Value* emitTieredCall(llvm::Function* func, const std::vector<llvm::Value*>& args, llvm::IRBuilder<>& builder);
+        void tierUp(int32_t id);
+        void compileTier1(int32_t id);
+        static void tierUpTrampoline(Engine* engine, int32_t id);
+
+    private:
+        // Profile guided optimization (profile.cpp)
+        std::string profileKey(const char* kind, const edn::EdnNode& node, const std::string& site) const;
+        void recordProfileSite(const std::string& key, llvm::IRBuilder<>& builder);
+        void emitProfileCounter(const std::string& key, llvm::IRBuilder<>& builder);
+        uint64_t profileCount(const std::string& key) const;
+        void setBranchWeights(llvm::Instruction* branch, uint64_t taken, uint64_t notTaken);
+        void setBranchWeights(llvm::Instruction* branch, const std::vector<uint64_t>& weights);
+        bool loadProfile();
+        void writeProfile();
+        void attachProfileSummary();
 
-        std::string dumpModule();
+    private:
+        // Artifact output (emit.cpp) and function multiversioning (multiversion.cpp)
+        void emitArtifact(llvm::Module& module, bool standalone);
+        void multiversionFunctions(llvm::Module& module, llvm::TargetMachine& targetMachine);
+
+    private:
+        // Statistics (stats.cpp)
+        void printFunctionStats(const llvm::Module& module, const std::string& stage);
+
+    private:
+        // SIMD vector builtins (vector.cpp)
+        llvm::Value* codegenSplat(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenExtract(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenInsert(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenShuffle(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenReduce(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenLaneIndex(const edn::EdnNode& node, TypeRef vectorType, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+
+    private:
+        // Arrays and slices (arrays.cpp)
+        llvm::Value* codegenAssignArray(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        void storeArray(const edn::EdnNode& valueNode, TypeRef type, llvm::Value* array, llvm::Value* value, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenAt(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenSetAt(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenLen(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenSlice(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* codegenArrayLiteral(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Value* writableArray(TypeRef type, llvm::Value* array, llvm::IRBuilder<>& builder);
+        llvm::Value* elementAddress(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        std::pair<llvm::Value*, llvm::Value*> arrayData(TypeRef type, llvm::Value* value, llvm::IRBuilder<>& builder);
+        void emitBoundsCheck(const edn::EdnNode& node, llvm::Value* inBounds, const char* failure, const std::vector<llvm::Value*>& values, llvm::IRBuilder<>& builder);
+        void trapBoundsFailures(llvm::Module& module);
+        static void indexFailureTrampoline(Engine* engine, int32_t line, int32_t column, int64_t index, int64_t length);
+        static void sliceFailureTrampoline(Engine* engine, int32_t line, int32_t column, int64_t start, int64_t end, int64_t length);
+
+    private:
+        // Globals and constants (globals.cpp)
+        llvm::Value* codegenDef(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder);
+        llvm::Constant* constantInitializer(const edn::EdnNode& valueNode, TypeRef type, llvm::Value* value, llvm::IRBuilder<>& builder);
+
+    private:
+        // Optimization remarks (remarks.cpp)
+        void enableRemarks(llvm::LLVMContext& context);
+        llvm::DILocation* loopLocation(llvm::Function* function, const edn::EdnNode& node);
+        void finalizeRemarks();
+        // Location-only debug info of the module being compiled, see remarks.cpp
+        std::unique_ptr<llvm::DIBuilder> remarkDebugInfo;
+        llvm::DIFile* remarkFile = nullptr;
+        std::unordered_map<llvm::Function*, llvm::DISubprogram*> remarkScopes;
+
+    private:
+        llvm::Timer* phaseTimer(const std::string& name);
+        void printTargetInfo();
+        void optimizeModule(llvm::Module& module, unsigned optLevel);
+        void defineHostSymbol(const std::string& name, void* address);
+        llvm::AllocaInst* createEntryAlloca(llvm::IRBuilder<>& builder, llvm::Type* type, const std::string& name);
+        TypeRef resolveType(const edn::EdnNode& node, const std::string& typeStr);
+        // Interned form of the type the checker resolved for the node
+        TypeRef typeOf(const edn::EdnNode& node);
+        llvm::Value* convertValue(const edn::EdnNode& node, llvm::Value* value, TypeRef fromType, TypeRef toType, llvm::IRBuilder<>& builder);
     };
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <fmt/format.h>
+
+// Globals and constants
+//
+// (def name :type value) is a module-level variable, an LLVM global that calc
+// and every defn read and write directly. A value that folds to a constant is
+// the global's initializer; anything else is stored when the def runs, which
+// is in calc, before main. Globals are internal so GlobalOpt sees every access
+// and can fold one that is never written; only with --tiered are they external,
+// for the tier-1 modules to link against.
+//
+// (const name :type value) is evaluated while generating code and has no
+// storage: uses get the llvm::Constant itself, so they fold into the code
+// around them in every function, at any -O level. A const array is a private
+// constant global, like an array literal.
+
+// (def name :type value) / (const name :type value)
+llvm::Value* Engine::codegenDef(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenDef", [&] { return traceDetail(node); });
+    bool isConst = node.values.front().value == "const";
+    const edn::EdnNode& nameNode = *std::next(node.values.begin());
+    const edn::EdnNode& typeNode = *std::next(node.values.begin(), 2);
+    const edn::EdnNode& valueNode = node.values.back();
+    TypeRef type = resolveType(typeNode, typeNode.value.substr(1));
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    if (!type->isArray()) {
+        value = convertValue(valueNode, value, typeOf(valueNode), type, builder);
+    }
+    llvm::Constant* initializer = constantInitializer(valueNode, type, value, builder);
+    llvm::Module& module = *builder.GetInsertBlock()->getModule();
+
+    if (isConst) {
+        if (!initializer) {
+            throw YeetCompileException(valueNode, fmt::format("const {}: value is not known at compile time", nameNode.value), filePath, __FILE__, __LINE__);
+        }
+        if (type->isArray()) {
+            // An array literal already is a constant global
+            auto global = llvm::dyn_cast<llvm::GlobalVariable>(value);
+            if (!global || !global->isConstant()) {
+                global = new llvm::GlobalVariable(module, type->llvmType, true, llvm::GlobalValue::PrivateLinkage, initializer, nameNode.value);
+                global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+                global->setAlignment(llvm::Align(type->alignment));
+            }
+            initializer = global;
+        }
+        symbols.declareGlobal(nameNode.value, initializer, type, true);
+        return nullptr;
+    }
+
+    auto linkage = options.tiered ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::InternalLinkage;
+    auto global = new llvm::GlobalVariable(module, type->llvmType, false, linkage,
+        initializer ? initializer : llvm::Constant::getNullValue(type->llvmType), nameNode.value);
+    global->setAlignment(llvm::Align(type->alignment));
+    if (!initializer) {
+        if (type->isArray()) {
+            storeArray(valueNode, type, global, value, builder);
+        } else {
+            builder.CreateStore(value, global);
+        }
+    }
+    symbols.declareGlobal(nameNode.value, global, type, false);
+    return nullptr;
+}
+
+// value as a global's initializer: scalars and vectors that folded to a
+// constant, a copy of a constant array, or an element that folded to a
+// constant repeated. nullptr when it is only known at run time.
+llvm::Constant* Engine::constantInitializer(const edn::EdnNode& valueNode, TypeRef type, llvm::Value* value, llvm::IRBuilder<>& builder) {
+    if (!type->isArray()) return llvm::dyn_cast<llvm::Constant>(value);
+    if (typeOf(valueNode) == type) {
+        auto global = llvm::dyn_cast<llvm::GlobalVariable>(value);
+        return global && global->isConstant() ? global->getInitializer() : nullptr;
+    }
+    if (!llvm::isa<llvm::Constant>(value)) return nullptr;
+    // Converting a constant folds, no instructions are emitted
+    auto element = llvm::dyn_cast<llvm::Constant>(convertValue(valueNode, value, typeOf(valueNode), type->element, builder));
+    if (!element) return nullptr;
+    auto arrayType = llvm::cast<llvm::ArrayType>(type->llvmType);
+    if (element->isNullValue()) return llvm::ConstantAggregateZero::get(arrayType);
+    return llvm::ConstantArray::get(arrayType, std::vector<llvm::Constant*>(type->length, element));
+}
@@ -0,0 +1,146 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <array>
+#include <fmt/format.h>
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+// Function multiversioning for AOT objects
+//
+// Every defn function is cloned once per --multiversion CPU as <name>.<cpu>
+// with matching target-cpu/target-features attributes, and <name> becomes an
+// ifunc. Its resolver runs at load time, asks libgcc/compiler-rt's
+// __cpu_model which x86 features the machine has, and binds the newest
+// variant the machine supports. Variants call each other directly.
+
+// Feature numbers shared by libgcc and compiler-rt: 0-31 are bits of
+// __cpu_model.__cpu_features[0], 32 and up bits of __cpu_features2[0].
+// Features past these (movbe, f16c, lzcnt, xsave, ...) are numbered
+// differently by the two runtimes, so the resolvers cannot ask for them. They
+// are approximated by the ones tested here: every CPU with avx2, bmi2 and fma
+// (x86-64-v3) or avx512f/bw/dq/vl (x86-64-v4) also has them.
+static const std::pair<const char*, unsigned> cpuModelFeatureBits[] = {
+    {"cmov", 0}, {"mmx", 1}, {"popcnt", 2}, {"sse", 3}, {"sse2", 4}, {"sse3", 5}, {"ssse3", 6},
+    {"sse4.1", 7}, {"sse4.2", 8}, {"avx", 9}, {"avx2", 10}, {"sse4a", 11}, {"fma4", 12}, {"xop", 13},
+    {"fma", 14}, {"avx512f", 15}, {"bmi", 16}, {"bmi2", 17}, {"aes", 18}, {"pclmul", 19},
+    {"avx512vl", 20}, {"avx512bw", 21}, {"avx512dq", 22}, {"avx512cd", 23},
+    {"avx512vbmi", 26}, {"avx512ifma", 27}, {"avx512vpopcntdq", 30}, {"avx512vbmi2", 31},
+    {"gfni", 32}, {"vpclmulqdq", 33}, {"avx512vnni", 34}, {"avx512bitalg", 35}, {"avx512bf16", 36},
+    {"avx512vp2intersect", 37},
+};
+
+// Required bits of __cpu_features[0] and __cpu_features2[0]
+using CpuFeatureMask = std::array<uint32_t, 2>;
+
+// Feature bits a machine needs before the given CPU's variant may run
+static CpuFeatureMask cpuFeatureMask(llvm::TargetMachine& targetMachine, const std::string& cpu)
+{
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget(targetMachine.getTarget().createMCSubtargetInfo(
+        targetMachine.getTargetTriple().str(), cpu, ""));
+    CpuFeatureMask mask = {0, 0};
+    for (const auto& [feature, bit] : cpuModelFeatureBits) {
+        if (subtarget->checkFeatures(fmt::format("+{}", feature))) {
+            mask[bit / 32] |= 1u << (bit % 32);
+        }
+    }
+    return mask;
+}
+
+void Engine::multiversionFunctions(llvm::Module& module, llvm::TargetMachine& targetMachine)
+{
+    const std::vector<std::string>& cpus = options.multiversion;
+    llvm::LLVMContext& context = module.getContext();
+    llvm::IRBuilder<> builder(context);
+
+    // Everything outside the variants (calc, resolvers) has to run on the oldest CPU
+    for (auto& function : module) {
+        if (!function.isDeclaration()) {
+            function.addFnAttr("target-cpu", cpus.front());
+            function.addFnAttr("target-features", "");
+        }
+    }
+
+    // 1 Clone each defn once per CPU. Later steps go through cloned, in
+    // definition order, so the emitted module is the same on every run.
+    std::unordered_map<llvm::Function*, std::vector<llvm::Function*>> variants;
+    std::vector<llvm::Function*> cloned;
+    for (const auto& name : yeetFunctionOrder) {
+        llvm::Function* function = module.getFunction(name);
+        if (!function || function->isDeclaration()) continue;
+        for (const auto& cpu : cpus) {
+            llvm::ValueToValueMapTy valueMap;
+            llvm::Function* variant = llvm::CloneFunction(function, valueMap);
+            variant->setName(fmt::format("{}.{}", name, cpu));
+            variant->setLinkage(llvm::GlobalValue::InternalLinkage);
+            variant->addFnAttr("target-cpu", cpu);
+            variants[function].push_back(variant);
+        }
+        cloned.push_back(function);
+    }
+
+    // 2 Calls between variants stay on the same ISA instead of going back through the ifunc
+    for (llvm::Function* function : cloned) {
+        const std::vector<llvm::Function*>& functionVariants = variants.at(function);
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            for (auto& block : *functionVariants[i]) {
+                for (auto& inst : block) {
+                    auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+                    if (!call) continue;
+                    auto calleeIt = variants.find(call->getCalledFunction());
+                    if (calleeIt != variants.end()) {
+                        call->setCalledFunction(calleeIt->second[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // 3 Resolver: newest variant whose features are all present, the first CPU is the fallback
+    auto cpuModelType = llvm::StructType::get(context, {builder.getInt32Ty(), builder.getInt32Ty(),
+        builder.getInt32Ty(), llvm::ArrayType::get(builder.getInt32Ty(), 1)});
+    llvm::Constant* cpuModel = module.getOrInsertGlobal("__cpu_model", cpuModelType);
+    llvm::FunctionCallee cpuInit = module.getOrInsertFunction("__cpu_indicator_init", builder.getVoidTy());
+    std::vector<CpuFeatureMask> masks;
+    bool needsFeatures2 = false;
+    for (const auto& cpu : cpus) {
+        masks.push_back(cpuFeatureMask(targetMachine, cpu));
+        needsFeatures2 |= masks.back()[1] != 0;
+    }
+    // Only referenced when a variant needs it, older runtimes may not define it
+    llvm::Constant* cpuFeatures2 = needsFeatures2 ? module.getOrInsertGlobal("__cpu_features2", builder.getInt32Ty()) : nullptr;
+
+    for (llvm::Function* function : cloned) {
+        const std::vector<llvm::Function*>& functionVariants = variants.at(function);
+        std::string name = function->getName().str();
+        auto resolverType = llvm::FunctionType::get(builder.getPtrTy(), false);
+        auto resolver = llvm::Function::Create(resolverType, llvm::GlobalValue::InternalLinkage, name + ".resolver", module);
+        resolver->addFnAttr("target-cpu", cpus.front());
+        resolver->addFnAttr("target-features", "");
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", resolver));
+        builder.CreateCall(cpuInit);
+        llvm::Value* featuresPtr = builder.CreateConstInBoundsGEP2_32(cpuModelType, cpuModel, 0, 3);
+        llvm::Value* features = builder.CreateLoad(builder.getInt32Ty(), featuresPtr, "features");
+        llvm::Value* features2 = cpuFeatures2 ? builder.CreateLoad(builder.getInt32Ty(), cpuFeatures2, "features2") : nullptr;
+        llvm::Value* selected = functionVariants.front();
+        for (size_t i = 1; i < functionVariants.size(); ++i) {
+            llvm::Value* present = builder.CreateAnd(features, builder.getInt32(masks[i][0]));
+            llvm::Value* supported = builder.CreateICmpEQ(present, builder.getInt32(masks[i][0]));
+            if (masks[i][1] != 0) {
+                llvm::Value* present2 = builder.CreateAnd(features2, builder.getInt32(masks[i][1]));
+                supported = builder.CreateAnd(supported, builder.CreateICmpEQ(present2, builder.getInt32(masks[i][1])));
+            }
+            supported->setName(fmt::format("has.{}", cpus[i]));
+            selected = builder.CreateSelect(supported, functionVariants[i], selected);
+        }
+        builder.CreateRet(selected);
+
+        auto ifunc = llvm::GlobalIFunc::create(function->getFunctionType(), 0, llvm::GlobalValue::ExternalLinkage, "", resolver, &module);
+        function->replaceAllUsesWith(ifunc);
+        ifunc->takeName(function);
+        function->eraseFromParent();
+    }
+}
@@ -0,0 +1,140 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <fmt/format.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
+
+// Profile guided optimization
+//
+// --profile-generate instruments every cond and case arm, while and for body/exit and defn
+// entry with a 64 bit counter global and dumps the counts after the run.
+// --profile-use reads that file back and turns the counts into branch
+// weights and function entry counts before the pass pipeline runs.
+//
+// Profile file format, one site per line:
+//   # yeet profile v1
+//   <kind>:<line>:<column>:<site> <count>
+
+std::string Engine::profileKey(const char* kind, const edn::EdnNode& node, const std::string& site) const
+{
+    return fmt::format("{}:{}:{}:{}", kind, node.line, node.column, site);
+}
+
+// The profile summary counts each site in the function that contains it
+void Engine::recordProfileSite(const std::string& key, llvm::IRBuilder<>& builder)
+{
+    profileSiteFunctions[key] = builder.GetInsertBlock()->getParent()->getName().str();
+}
+
+void Engine::emitProfileCounter(const std::string& key, llvm::IRBuilder<>& builder)
+{
+    recordProfileSite(key, builder);
+    if (options.profileGenerate.empty()) return;
+    llvm::Module& module = *builder.GetInsertBlock()->getModule();
+    llvm::Type* counterType = builder.getInt64Ty();
+    auto counter = new llvm::GlobalVariable(module, counterType, false, llvm::GlobalValue::ExternalLinkage,
+        llvm::ConstantInt::get(counterType, 0), fmt::format("__yeet_prof_{}", profileKeys.size()));
+    profileKeys.push_back(key);
+    llvm::Value* count = builder.CreateLoad(counterType, counter, "prof.count");
+    builder.CreateStore(builder.CreateAdd(count, builder.getInt64(1), "prof.inc"), counter);
+}
+
+uint64_t Engine::profileCount(const std::string& key) const
+{
+    auto it = profileCounts.find(key);
+    return it == profileCounts.end() ? 0 : it->second;
+}
+
+void Engine::setBranchWeights(llvm::Instruction* branch, uint64_t taken, uint64_t notTaken)
+{
+    setBranchWeights(branch, std::vector<uint64_t>{taken, notTaken});
+}
+
+// One weight per successor, in successor order
+void Engine::setBranchWeights(llvm::Instruction* branch, const std::vector<uint64_t>& weights)
+{
+    if (profileCounts.empty()) return;
+    // Branch weights are 32 bit, scale all of them down together
+    uint64_t scale = *std::max_element(weights.begin(), weights.end()) / std::numeric_limits<uint32_t>::max() + 1;
+    std::vector<uint32_t> scaled;
+    for (uint64_t weight : weights) {
+        scaled.push_back(static_cast<uint32_t>(weight / scale));
+    }
+    llvm::MDBuilder mdBuilder(branch->getContext());
+    branch->setMetadata(llvm::LLVMContext::MD_prof, mdBuilder.createBranchWeights(scaled));
+}
+
+bool Engine::loadProfile()
+{
+    std::ifstream in(options.profileUse);
+    if (!in) {
+        std::cerr << "Failed to open profile: " << options.profileUse << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        uint64_t count = 0;
+        if (!(fields >> key >> count)) {
+            std::cerr << "Malformed profile line in " << options.profileUse << ": " << line << std::endl;
+            return false;
+        }
+        profileCounts[key] += count;
+    }
+    return true;
+}
+
+void Engine::writeProfile()
+{
+    // Sorted so profiles diff cleanly between runs
+    std::map<std::string, uint64_t> counts;
+    for (size_t i = 0; i < profileKeys.size(); ++i) {
+        auto sym = jit->lookup(fmt::format("__yeet_prof_{}", i));
+        if (!sym) {
+            std::cerr << "Failed to find profile counter: " << llvm::toString(sym.takeError()) << std::endl;
+            return;
+        }
+        counts[profileKeys[i]] += *sym->toPtr<uint64_t*>();
+    }
+    std::ofstream out(options.profileGenerate);
+    if (!out) {
+        std::cerr << "Failed to write profile: " << options.profileGenerate << std::endl;
+        return;
+    }
+    out << "# yeet profile v1\n";
+    for (const auto& [key, count] : counts) {
+        out << key << " " << count << "\n";
+    }
+}
+
+// The inliner and block placement only trust entry counts once the module carries a profile summary
+void Engine::attachProfileSummary()
+{
+    // Records are (entry count, internal counts...) per function; a defn's entry site is its entry count
+    std::unordered_map<std::string, std::vector<uint64_t>> siteCounts;
+    for (const auto& [key, function] : profileSiteFunctions) {
+        if (key.rfind("defn:", 0) == 0) continue;
+        siteCounts[function].push_back(profileCount(key));
+    }
+    llvm::InstrProfSummaryBuilder summaryBuilder(llvm::ProfileSummaryBuilder::DefaultCutoffs);
+    for (const auto& function : *mod) {
+        auto entryCount = function.getEntryCount();
+        if (!entryCount) continue;
+        std::vector<uint64_t> counts = {entryCount->getCount()};
+        auto sites = siteCounts.find(function.getName().str());
+        if (sites != siteCounts.end()) {
+            counts.insert(counts.end(), sites->second.begin(), sites->second.end());
+        }
+        summaryBuilder.addRecord(llvm::InstrProfRecord(std::move(counts)));
+    }
+    mod->setProfileSummary(summaryBuilder.getSummary()->getMD(mod->getContext()), llvm::ProfileSummary::PSK_Instr);
+}
@@ -0,0 +1,88 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <fmt/format.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/DIBuilder.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/Support/Path.h>
+
+// --remarks: what the loop unroller and vectorizer did with every loop, and
+// whether the :unroll/:vectorize/:interleave hints were honored. A hint the
+// optimizer could not apply shows up as a transform-warning.
+//
+// Every llvm.loop node carries the .yeet line and column of its while/for, so
+// remarks point back at the form. The locations hang off a compile unit that
+// emits no debug info (like clang's location tracking for -Rpass without -g);
+// nothing outside the loop IDs gets a debug location.
+
+namespace {
+    bool isLoopPass(llvm::StringRef passName)
+    {
+        return passName == "loop-unroll" || passName == "loop-vectorize" || passName == "transform-warning";
+    }
+
+    class RemarkHandler : public llvm::DiagnosticHandler
+    {
+    public:
+        explicit RemarkHandler(const std::string& filePath) : filePath(filePath) {}
+
+        bool isAnalysisRemarkEnabled(llvm::StringRef) const override { return false; }
+        bool isMissedOptRemarkEnabled(llvm::StringRef passName) const override { return isLoopPass(passName); }
+        bool isPassedOptRemarkEnabled(llvm::StringRef passName) const override { return isLoopPass(passName); }
+        // Asked without a pass name before any remark is built
+        bool isAnyRemarkEnabled() const override { return true; }
+
+        bool handleDiagnostics(const llvm::DiagnosticInfo& info) override
+        {
+            auto remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+            if (!remark) return false;
+            // The vectorizer explains why a forced (hinted) loop failed with analyses that are always printed
+            auto analysis = llvm::dyn_cast<llvm::OptimizationRemarkAnalysis>(remark);
+            bool forced = analysis && analysis->shouldAlwaysPrint();
+            if (!forced && !isLoopPass(remark->getPassName())) return false;
+            const char* kind = remark->isPassed() ? "remark" : remark->isMissed() ? "missed" : remark->isAnalysis() ? "note" : "warning";
+            std::string where = remark->isLocationAvailable()
+                ? fmt::format("{}({},{})", filePath, remark->getLocation().getLine(), remark->getLocation().getColumn())
+                : fmt::format("{}({})", filePath, remark->getFunction().getName().str());
+            std::string pass = forced ? "" : remark->getPassName().str() + ": ";
+            std::cerr << fmt::format("{} : {}: {}{}", where, kind, pass, remark->getMsg()) << std::endl;
+            return true;
+        }
+
+    private:
+        std::string filePath;
+    };
+}
+
+void Engine::enableRemarks(llvm::LLVMContext& context)
+{
+    context.setDiagnosticHandler(std::make_unique<RemarkHandler>(filePath));
+}
+
+llvm::DILocation* Engine::loopLocation(llvm::Function* function, const edn::EdnNode& node)
+{
+    if (!remarkDebugInfo) {
+        remarkDebugInfo = std::make_unique<llvm::DIBuilder>(*mod);
+        remarkFile = remarkDebugInfo->createFile(llvm::sys::path::filename(filePath), llvm::sys::path::parent_path(filePath));
+        remarkDebugInfo->createCompileUnit(llvm::dwarf::DW_LANG_C, remarkFile, "yeet", options.optLevel > 0, "", 0, "",
+            llvm::DICompileUnit::NoDebug);
+    }
+    llvm::DISubprogram*& scope = remarkScopes[function];
+    if (!scope) {
+        auto subroutineType = remarkDebugInfo->createSubroutineType(remarkDebugInfo->getOrCreateTypeArray({}));
+        scope = remarkDebugInfo->createFunction(remarkFile, function->getName(), function->getName(), remarkFile, node.line,
+            subroutineType, node.line, llvm::DINode::FlagZero, llvm::DISubprogram::SPFlagDefinition);
+    }
+    return llvm::DILocation::get(function->getContext(), node.line, node.column, scope);
+}
+
+void Engine::finalizeRemarks()
+{
+    if (!remarkDebugInfo) return;
+    remarkDebugInfo->finalize();
+    mod->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+    remarkDebugInfo.reset();
+    remarkFile = nullptr;
+    remarkScopes.clear();
+}
@@ -0,0 +1,75 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <fmt/format.h>
+#include <llvm/IR/Instructions.h>
+
+// --stats: per function IR shape, printed once straight out of codegen and
+// again after the pass pipeline so implicit conversions and stack traffic
+// that survive optimization stand out.
+
+namespace {
+    struct FunctionStats {
+        size_t instructions = 0;
+        size_t blocks = 0;
+        size_t allocas = 0;
+        size_t loads = 0;
+        size_t stores = 0;
+        size_t casts = 0;
+        size_t calls = 0;
+
+        void add(const FunctionStats& other) {
+            instructions += other.instructions;
+            blocks += other.blocks;
+            allocas += other.allocas;
+            loads += other.loads;
+            stores += other.stores;
+            casts += other.casts;
+            calls += other.calls;
+        }
+    };
+
+    FunctionStats collectStats(const llvm::Function& function)
+    {
+        FunctionStats stats;
+        for (const auto& block : function) {
+            ++stats.blocks;
+            for (const auto& inst : block) {
+                ++stats.instructions;
+                if (llvm::isa<llvm::AllocaInst>(inst)) ++stats.allocas;
+                else if (llvm::isa<llvm::LoadInst>(inst)) ++stats.loads;
+                else if (llvm::isa<llvm::StoreInst>(inst)) ++stats.stores;
+                else if (llvm::isa<llvm::CastInst>(inst)) ++stats.casts;
+                else if (llvm::isa<llvm::CallBase>(inst)) ++stats.calls;
+            }
+        }
+        return stats;
+    }
+
+    std::string formatRow(const std::string& name, const FunctionStats& stats)
+    {
+        return fmt::format("{:<28}{:>8}{:>8}{:>8}{:>8}{:>8}{:>8}{:>8}\n", name, stats.instructions, stats.blocks,
+            stats.allocas, stats.loads, stats.stores, stats.casts, stats.calls);
+    }
+}
+
+void Engine::printFunctionStats(const llvm::Module& module, const std::string& stage)
+{
+    // Built up front so reports from tier-up threads don't interleave
+    std::string report = fmt::format("=== Function stats ({}) ===\n", stage);
+    report += fmt::format("{:<28}{:>8}{:>8}{:>8}{:>8}{:>8}{:>8}{:>8}\n", "function", "insts", "blocks",
+        "allocas", "loads", "stores", "casts", "calls");
+    FunctionStats total;
+    size_t functions = 0;
+    for (const auto& function : module) {
+        if (function.isDeclaration()) continue;
+        FunctionStats stats = collectStats(function);
+        report += formatRow(function.getName().str(), stats);
+        total.add(stats);
+        ++functions;
+    }
+    if (functions > 1) {
+        report += formatRow("total", total);
+    }
+    std::cerr << report << std::flush;
+}
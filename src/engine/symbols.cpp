@@ -0,0 +1,66 @@
+#include "symbols.hpp"
+
+using namespace yeet;
+
+void SymbolTable::pushScope()
+{
+    scopes.push_back(symbols.size());
+}
+
+void SymbolTable::popScope()
+{
+    size_t begin = scopes.back();
+    scopes.pop_back();
+    while (symbols.size() > begin) {
+        auto it = bindings.find(symbols.back().name);
+        it->second.pop_back();
+        if (it->second.empty()) {
+            bindings.erase(it);
+        }
+        symbols.pop_back();
+    }
+}
+
+void SymbolTable::pushFunction()
+{
+    functions.push_back(symbols.size());
+    pushScope();
+}
+
+void SymbolTable::popFunction()
+{
+    popScope();
+    functions.pop_back();
+}
+
+void SymbolTable::clear()
+{
+    symbols.clear();
+    scopes.clear();
+    functions.clear();
+    bindings.clear();
+    globals.clear();
+}
+
+SymbolTable::Symbol* SymbolTable::lookup(const std::string& name)
+{
+    auto it = bindings.find(name);
+    if (it != bindings.end()) {
+        size_t index = it->second.back();
+        // Bound, but by a function further out
+        if (functions.empty() || index >= functions.back()) return &symbols[index];
+    }
+    auto global = globals.find(name);
+    return global != globals.end() ? &global->second : nullptr;
+}
+
+void SymbolTable::declare(const std::string& name, llvm::Value* value, TypeRef type)
+{
+    bindings[name].push_back(symbols.size());
+    symbols.push_back({name, value, type});
+}
+
+void SymbolTable::declareGlobal(const std::string& name, llvm::Value* value, TypeRef type, bool constant)
+{
+    globals[name] = {name, value, type, constant};
+}
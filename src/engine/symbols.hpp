@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/IR/Value.h>
+
+#include "types.hpp"
+
+namespace yeet
+{
+    // Variables visible to the code being generated. Bindings sit in one flat
+    // vector in declaration order and a scope is the index of its first binding,
+    // so leaving a scope truncates the vector. Each name keeps the stack of its
+    // binding indices, which makes a lookup a single hash probe.
+    // A function scope is a barrier: while a callee body is generated in the
+    // middle of its caller, the caller's bindings are not visible to it.
+    // Globals (def and const) sit outside every function and are seen from all
+    // of them, below any local of the same name.
+    class SymbolTable
+    {
+    public:
+        struct Symbol {
+            std::string name;
+            // The variable's alloca or global, or the argument itself for pointer
+            // parameters. A const holds its value.
+            llvm::Value* value = nullptr;
+            TypeRef type = nullptr;
+            bool constant = false;
+        };
+
+        // while bodies and cond arms
+        void pushScope();
+        void popScope();
+        // defn bodies and calc
+        void pushFunction();
+        void popFunction();
+        void clear();
+
+        // nullptr when the name is not bound in the current function. The pointer
+        // is only good until the next declare.
+        Symbol* lookup(const std::string& name);
+        // Binds in the innermost scope
+        void declare(const std::string& name, llvm::Value* value, TypeRef type);
+        void declareGlobal(const std::string& name, llvm::Value* value, TypeRef type, bool constant);
+
+    private:
+        std::vector<Symbol> symbols;
+        // First binding of every open scope / function, innermost last
+        std::vector<size_t> scopes;
+        std::vector<size_t> functions;
+        std::unordered_map<std::string, std::vector<size_t>> bindings;
+        std::unordered_map<std::string, Symbol> globals;
+    };
+}
@@ -0,0 +1,161 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <atomic>
+#include <fmt/format.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TimeProfiler.h>
+
+// Tiered compilation
+//
+// Every defn function is emitted at -O0 and called through a stub global
+// (<name>.tier.stub) holding the address of its current implementation.
+// The function prologue bumps <name>.tier.count and calls back into the
+// engine when it crosses the threshold. The engine then recompiles that one
+// function at -O3 on a background thread as <name>.tier1 and swaps the stub,
+// so callers pick up the optimized body on their next call.
+
+// entry:     old = atomicrmw add <name>.tier.count, 1
+//            br (old == threshold - 1), tier.up, tier.body
+// tier.up:   call yeet_tier_up(engine, id)
+// tier.body: <function body>
+void Engine::emitTierPrologue(llvm::Function* func, llvm::IRBuilder<>& builder)
+{
+    llvm::Module& module = *func->getParent();
+    llvm::LLVMContext& context = module.getContext();
+    std::string name = func->getName().str();
+    auto id = static_cast<int32_t>(tieredFunctions.size());
+    tieredFunctions.push_back(name);
+
+    llvm::Type* counterType = builder.getInt64Ty();
+    auto counter = new llvm::GlobalVariable(module, counterType, false, llvm::GlobalValue::ExternalLinkage,
+        llvm::ConstantInt::get(counterType, 0), name + ".tier.count");
+    new llvm::GlobalVariable(module, func->getType(), false, llvm::GlobalValue::ExternalLinkage,
+        func, name + ".tier.stub");
+
+    llvm::BasicBlock* tierUpBB = llvm::BasicBlock::Create(context, "tier.up", func);
+    llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(context, "tier.body", func);
+    llvm::Value* calls = builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, counter, llvm::ConstantInt::get(counterType, 1),
+        llvm::MaybeAlign(8), llvm::AtomicOrdering::Monotonic);
+    // Compare against the old value so exactly one call triggers the recompile
+    llvm::Value* hot = builder.CreateICmpEQ(calls, llvm::ConstantInt::get(counterType, options.tierThreshold - 1), "tier.hot");
+    builder.CreateCondBr(hot, tierUpBB, bodyBB);
+
+    builder.SetInsertPoint(tierUpBB);
+    llvm::FunctionCallee tierUpFn = module.getOrInsertFunction("yeet_tier_up",
+        builder.getVoidTy(), builder.getPtrTy(), builder.getInt32Ty());
+    llvm::Value* enginePtr = llvm::ConstantExpr::getIntToPtr(
+        builder.getInt64(reinterpret_cast<uint64_t>(this)), builder.getPtrTy());
+    builder.CreateCall(tierUpFn, {enginePtr, builder.getInt32(id)});
+    builder.CreateBr(bodyBB);
+
+    builder.SetInsertPoint(bodyBB);
+}
+
+// Calls load the current implementation from the stub so a swapped in tier-1 body is seen without a pause
+llvm::Value* Engine::emitTieredCall(llvm::Function* func, const std::vector<llvm::Value*>& args, llvm::IRBuilder<>& builder)
+{
+    llvm::Module& module = *builder.GetInsertBlock()->getModule();
+    llvm::GlobalVariable* stub = module.getNamedGlobal(func->getName().str() + ".tier.stub");
+    if (!stub) {
+        return builder.CreateCall(func, args, "calltmp");
+    }
+    llvm::LoadInst* impl = builder.CreateAlignedLoad(func->getType(), stub,
+        module.getDataLayout().getPointerABIAlignment(0), func->getName() + ".impl");
+    impl->setAtomic(llvm::AtomicOrdering::Monotonic);
+    return builder.CreateCall(func->getFunctionType(), impl, args, "calltmp");
+}
+
+void Engine::tierUpTrampoline(Engine* engine, int32_t id)
+{
+    engine->tierUp(id);
+}
+
+// Called from JIT'd code the moment a function crosses the threshold: never compile on the caller's thread
+void Engine::tierUp(int32_t id)
+{
+    std::lock_guard<std::mutex> lock(tierMutex);
+    bool traced = llvm::timeTraceProfilerEnabled();
+    tierThreads.emplace_back([this, id, traced] {
+        // The trace profiler is per thread; hand this thread's spans over before it exits
+        if (traced) {
+            llvm::timeTraceProfilerInitialize(options.traceGranularity, "yeet tier-up");
+        }
+        compileTier1(id);
+        if (traced) {
+            llvm::timeTraceProfilerFinishThread();
+        }
+    });
+}
+
+void Engine::compileTier1(int32_t id)
+{
+    const std::string& name = tieredFunctions.at(id);
+    llvm::TimeTraceScope timeScope("TierUp", name);
+    auto tierContext = std::make_unique<llvm::LLVMContext>();
+    if (options.remarks) {
+        enableRemarks(*tierContext);
+    }
+    auto buffer = llvm::MemoryBuffer::getMemBuffer(tierBitcode, "tier1", false);
+    auto tierModOrErr = llvm::parseBitcodeFile(buffer->getMemBufferRef(), *tierContext);
+    if (!tierModOrErr) {
+        std::cerr << "Tier-up of " << name << " failed: " << llvm::toString(tierModOrErr.takeError()) << std::endl;
+        return;
+    }
+    std::unique_ptr<llvm::Module> tierMod = std::move(*tierModOrErr);
+
+    // Keep only the hot function; everything else resolves against the tier-0 definitions.
+    // Private constants (array literals) are not visible outside tier 0, the copy keeps its own.
+    for (auto& global : tierMod->globals()) {
+        if (global.isConstant() && global.hasLocalLinkage()) continue;
+        if (!global.isDeclaration()) {
+            global.setInitializer(nullptr);
+            global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        }
+    }
+    for (auto& function : *tierMod) {
+        if (function.getName() != name && !function.isDeclaration()) {
+            function.deleteBody();
+        }
+    }
+    llvm::Function* func = tierMod->getFunction(name);
+    if (!func) {
+        std::cerr << "Tier-up of " << name << " failed: function missing from snapshot" << std::endl;
+        return;
+    }
+    func->setName(name + ".tier1");
+
+    // The optimized copy never tiers up again, drop the entry counter
+    llvm::BasicBlock& entry = func->getEntryBlock();
+    auto branch = llvm::cast<llvm::BranchInst>(entry.getTerminator());
+    auto hot = llvm::cast<llvm::Instruction>(branch->getCondition());
+    auto calls = llvm::cast<llvm::Instruction>(hot->getOperand(0));
+    llvm::BasicBlock* bodyBB = branch->getSuccessor(1);
+    branch->eraseFromParent();
+    hot->eraseFromParent();
+    calls->eraseFromParent();
+    llvm::BranchInst::Create(bodyBB, &entry);
+
+    optimizeModule(*tierMod, 3);
+    if (options.stats) {
+        printFunctionStats(*tierMod, fmt::format("{} after tier-up to -O3", name));
+    }
+
+    if (auto err = jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(tierMod), std::move(tierContext)))) {
+        std::cerr << "Tier-up of " << name << " failed: " << llvm::toString(std::move(err)) << std::endl;
+        return;
+    }
+    auto tier1Sym = jit->lookup(name + ".tier1");
+    if (!tier1Sym) {
+        std::cerr << "Tier-up of " << name << " failed: " << llvm::toString(tier1Sym.takeError()) << std::endl;
+        return;
+    }
+    auto stubSym = jit->lookup(name + ".tier.stub");
+    if (!stubSym) {
+        std::cerr << "Tier-up of " << name << " failed: " << llvm::toString(stubSym.takeError()) << std::endl;
+        return;
+    }
+    std::atomic_ref<void*> stub(*stubSym->toPtr<void**>());
+    stub.store(tier1Sym->toPtr<void*>(), std::memory_order_release);
+}
@@ -0,0 +1,1154 @@
+#include "engine.hpp"
+#include "typecheck.hpp"
+
+using namespace yeet;
+#include <set>
+#include <fmt/format.h>
+
+bool yeet::isIntegerType(const std::string& type)
+{
+    return type == "int8" || type == "int16" || type == "int32" || type == "int64";
+}
+
+bool yeet::isFloatType(const std::string& type)
+{
+    return type == "float32" || type == "float64";
+}
+
+bool yeet::isNumericType(const std::string& type)
+{
+    return isIntegerType(type) || isFloatType(type) || type == "bool";
+}
+
+bool yeet::isPointerType(const std::string& type)
+{
+    return !type.empty() && type.back() == '*';
+}
+
+unsigned yeet::integerBitWidth(const std::string& type)
+{
+    if (type == "bool") return 1;
+    if (type == "int8") return 8;
+    if (type == "int16") return 16;
+    if (type == "int32") return 32;
+    if (type == "int64") return 64;
+    return 0;
+}
+
+bool yeet::splitVectorType(const std::string& type, std::string& element, unsigned& lanes)
+{
+    size_t x = type.rfind('x');
+    if (x == std::string::npos || x + 1 == type.size() || x + 3 < type.size()) return false;
+    if (!std::all_of(type.begin() + x + 1, type.end(), [](char c) { return c >= '0' && c <= '9'; })) return false;
+    element = type.substr(0, x);
+    lanes = std::stoul(type.substr(x + 1));
+    return isNumericType(element) && lanes >= 2 && lanes <= 64 && (lanes & (lanes - 1)) == 0;
+}
+
+bool yeet::isVectorType(const std::string& type)
+{
+    std::string element;
+    unsigned lanes = 0;
+    return splitVectorType(type, element, lanes);
+}
+
+std::string yeet::vectorElementType(const std::string& type)
+{
+    std::string element;
+    unsigned lanes = 0;
+    splitVectorType(type, element, lanes);
+    return element;
+}
+
+unsigned yeet::vectorLanes(const std::string& type)
+{
+    std::string element;
+    unsigned lanes = 0;
+    splitVectorType(type, element, lanes);
+    return lanes;
+}
+
+bool yeet::splitArrayType(const std::string& type, std::string& element, uint64_t& length)
+{
+    size_t open = type.rfind('[');
+    if (open == std::string::npos || open == 0 || type.back() != ']') return false;
+    std::string digits = type.substr(open + 1, type.size() - open - 2);
+    if (digits.size() > 12 || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) return false;
+    element = type.substr(0, open);
+    length = digits.empty() ? 0 : std::stoull(digits);
+    // T[0] is neither an array nor a slice
+    return digits.empty() || length > 0;
+}
+
+bool yeet::isArrayType(const std::string& type)
+{
+    std::string element;
+    uint64_t length = 0;
+    return splitArrayType(type, element, length) && length > 0;
+}
+
+bool yeet::isSliceType(const std::string& type)
+{
+    std::string element;
+    uint64_t length = 0;
+    return splitArrayType(type, element, length) && length == 0;
+}
+
+std::string yeet::arrayElementType(const std::string& type)
+{
+    std::string element;
+    uint64_t length = 0;
+    splitArrayType(type, element, length);
+    return element;
+}
+
+// Number of elements of an array type, 0 for a slice
+static uint64_t arrayLength(const std::string& type)
+{
+    std::string element;
+    uint64_t length = 0;
+    splitArrayType(type, element, length);
+    return length;
+}
+
+const std::string& yeet::nodeType(const edn::EdnNode& node)
+{
+    auto it = node.metadata.find("type");
+    if (it == node.metadata.end()) {
+        throw YeetCompileException(node, "Expression has no resolved type");
+    }
+    return it->second;
+}
+
+// Integer type of the given bit width, bool for 1
+static std::string integerTypeOfWidth(unsigned bits)
+{
+    return bits == 1 ? "bool" : fmt::format("int{}", bits);
+}
+
+// Type two numeric types meet at, the usual arithmetic conversions: the wider
+// float if both are floats, the float if only one is, otherwise the wider
+// integer. float32 operations stay in float32.
+static std::string commonNumericType(const std::string& a, const std::string& b)
+{
+    if (isFloatType(a) && isFloatType(b)) return a == "float64" || b == "float64" ? "float64" : "float32";
+    if (isFloatType(a)) return a;
+    if (isFloatType(b)) return b;
+    return integerTypeOfWidth(std::max(integerBitWidth(a), integerBitWidth(b)));
+}
+
+// Type a value of either type can take: the type itself when both agree, the
+// common numeric type for two numerics, the vector when the other is a scalar
+// that can be splat across it. False for anything else.
+static bool unifyTypes(const std::string& a, const std::string& b, std::string& common)
+{
+    if (a == b) {
+        common = a;
+        return true;
+    }
+    if (isNumericType(a) && isNumericType(b)) {
+        common = commonNumericType(a, b);
+        return true;
+    }
+    if (isVectorType(a) != isVectorType(b) && (isNumericType(a) || isNumericType(b))) {
+        common = isVectorType(a) ? a : b;
+        return true;
+    }
+    return false;
+}
+
+// Whether an integer literal can take the given type without changing value
+static bool literalFits(const std::string& value, const std::string& type)
+{
+    long long literal = 0;
+    try {
+        literal = std::stoll(value);
+    } catch (const std::exception&) {
+        return false;
+    }
+    unsigned bits = integerBitWidth(type);
+    if (bits >= 64) return true;
+    long long limit = 1LL << (bits - 1);
+    return literal >= -limit && literal < limit;
+}
+
+static bool isLiteral(const edn::EdnNode& node)
+{
+    return node.type == edn::EdnInt || node.type == edn::EdnFloat;
+}
+
+// Literals meeting a value of this type take it directly
+static bool takesLiterals(const std::string& type)
+{
+    return isNumericType(type) || isVectorType(type);
+}
+
+TypeChecker::TypeChecker(const std::string& filePath_) : filePath(filePath_) {}
+
+void TypeChecker::check(edn::EdnNode& root)
+{
+    scopes.assign(1, Scope());
+    globals.clear();
+    constants.clear();
+    functionScope = 0;
+    loopDepth = 0;
+    declareGlobals(root);
+    checkExpr(root);
+}
+
+// Structs and function signatures in source order, so bodies can call
+// functions defined further down and take parameters of any declared struct
+void TypeChecker::declareGlobals(const edn::EdnNode& node)
+{
+    if (node.type != edn::EdnList || node.values.empty()) return;
+    const edn::EdnNode& opNode = node.values.front();
+    if (opNode.type == edn::EdnSymbol && opNode.value == "struct") {
+        declareStruct(node);
+        return;
+    }
+    if (opNode.type == edn::EdnSymbol && opNode.value == "defn") {
+        declareFunction(node);
+    }
+    for (const auto& child : node.values) {
+        declareGlobals(child);
+    }
+}
+
+std::string TypeChecker::checkExpr(edn::EdnNode& node, const std::string& expected)
+{
+    using namespace edn;
+    std::string type;
+    // A literal meant for a vector or an array is one lane's (element's) value, splat when converted
+    std::string expectedScalar = isVectorType(expected) ? vectorElementType(expected) : isArrayType(expected) ? arrayElementType(expected) : expected;
+    switch (node.type) {
+        case EdnInt:
+            if (isIntegerType(expectedScalar) && literalFits(node.value, expectedScalar)) type = expectedScalar;
+            else type = literalFits(node.value, "int32") ? "int32" : "int64";
+            break;
+        case EdnFloat:
+            type = isFloatType(expectedScalar) ? expectedScalar : "float64";
+            break;
+        case EdnBool:
+            type = "bool";
+            break;
+        case EdnSymbol:
+            type = node.value == "else" ? "bool" : lookupVariable(node);
+            // An array stands for its address; as a value it can only be copied or viewed as a slice
+            if (isArrayType(type) && !isArrayType(expected) && !isSliceType(expected)) {
+                throw YeetCompileException(node, fmt::format("Array {} can only be indexed, copied or passed as a slice ({}[])", node.value, arrayElementType(type)), filePath, __FILE__, __LINE__);
+            }
+            break;
+        case EdnList:
+            type = checkList(node);
+            break;
+        case EdnVector:
+            type = checkArrayLiteral(node, expected);
+            if (!isArrayType(expected) && !isSliceType(expected)) {
+                throw YeetCompileException(node, fmt::format("Array literal can only be indexed, copied or passed as a slice ({}[])", arrayElementType(type)), filePath, __FILE__, __LINE__);
+            }
+            break;
+        default:
+            throw YeetCompileException(node, "Unsupported expression", filePath, __FILE__, __LINE__);
+    }
+    node.metadata["type"] = type;
+    return type;
+}
+
+// Same dispatch as Engine::codegenList
+std::string TypeChecker::checkList(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.empty()) throw YeetCompileException(node, "Empty expression", filePath, __FILE__, __LINE__);
+    bool allAreLists = true;
+    for (const auto& v : node.values) {
+        if (v.type != EdnList && v.type != EdnInt && v.type != EdnSymbol && v.type != EdnFloat && v.type != EdnBool) {
+            allAreLists = false;
+            break;
+        }
+    }
+    if (allAreLists && node.values.size() > 1 && node.values.front().type == EdnList) {
+        node.metadata["sequence"] = "true";
+        std::string last;
+        for (auto& expr : node.values) {
+            last = checkExpr(expr);
+        }
+        return last;
+    }
+    const EdnNode& opNode = node.values.front();
+    if (opNode.type != EdnSymbol) throw YeetCompileException(opNode, "Expected operator symbol", filePath, __FILE__, __LINE__);
+    const std::string& op = opNode.value;
+    if (op == ".") return checkStructAccess(node);
+    if (op == "ref") return checkReference(node);
+    if (op == "deref") return checkDereference(node);
+    if (op == "defn") return checkDefn(node);
+    if (op == "cond") return checkCond(node);
+    if (op == "select") return checkSelect(node);
+    if (op == "case") return checkCase(node);
+    if (op == "=") return checkAssign(node);
+    if (op == "def" || op == "const") return checkDef(node);
+    if (op == "put") return checkPut(node);
+    if (op == "while") return checkWhile(node);
+    if (op == "for") return checkFor(node);
+    if (op == "break" || op == "continue") return checkLoopExit(node);
+    if (op == "struct") return checkStruct(node);
+    if (op == "splat") return checkSplat(node);
+    if (op == "extract") return checkExtract(node);
+    if (op == "insert") return checkInsert(node);
+    if (op == "shuffle") return checkShuffle(node);
+    if (op == "reduce") return checkReduce(node);
+    if (op == "at") return checkAt(node);
+    if (op == "set-at") return checkSetAt(node);
+    if (op == "len") return checkLen(node);
+    if (op == "slice") return checkSlice(node);
+    if (op == "+" || op == "-" || op == "*" || op == "/" || op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=") {
+        return checkBinop(node);
+    }
+    if (functions.count(op) > 0) return checkCall(node);
+    throw YeetCompileException(opNode, fmt::format("Unknown operator: {}", op), filePath, __FILE__, __LINE__);
+}
+
+std::string TypeChecker::checkAssign(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() < 3) throw YeetCompileException(node, "Expected target and value", filePath, __FILE__, __LINE__);
+    auto it = std::next(node.values.begin());
+    EdnNode& targetNode = *it;
+
+    if (node.values.size() == 3) {
+        EdnNode& valueNode = *std::next(it);
+        // Struct: (= target (StructName (Field1 Field2 ...)))
+        if (targetNode.type == EdnSymbol) {
+            if (valueNode.type != EdnList || valueNode.values.size() < 2 || valueNode.values.front().type != EdnSymbol) {
+                throw YeetCompileException(valueNode, "Expected Struct assignment to be of form (StructName (Field1 Field2 ...))", filePath, __FILE__, __LINE__);
+            }
+            const std::string& structName = valueNode.values.front().value;
+            auto structIt = structs.find(structName);
+            if (structIt == structs.end()) {
+                throw YeetCompileException(valueNode.values.front(), fmt::format("Struct type not defined: {}", structName), filePath, __FILE__, __LINE__);
+            }
+            EdnNode& fieldsNode = *std::next(valueNode.values.begin());
+            if (fieldsNode.type != EdnList) throw YeetCompileException(fieldsNode, "Expected Struct fields", filePath, __FILE__, __LINE__);
+            const auto& fields = structIt->second.fields;
+            if (fieldsNode.values.size() != fields.size()) {
+                throw YeetCompileException(fieldsNode, fmt::format("Struct {} has {} fields, got {}", structName, fields.size(), fieldsNode.values.size()), filePath, __FILE__, __LINE__);
+            }
+            size_t i = 0;
+            for (auto& fieldValue : fieldsNode.values) {
+                expectConvertible(fieldValue, checkExpr(fieldValue, fields[i].second), fields[i].second);
+                ++i;
+            }
+            const std::string* existing = findVariable(targetNode.value);
+            if (existing && *existing != structName) {
+                throw YeetCompileException(targetNode, fmt::format("Variable {} is {}, cannot assign a {}", targetNode.value, *existing, structName), filePath, __FILE__, __LINE__);
+            }
+            if (!existing) scopes.back()[targetNode.value] = structName;
+            targetNode.metadata["type"] = structName;
+            // The construct evaluates to the struct's address
+            return structName + "*";
+        }
+        // Struct field assignment: (= (. target :field) value)
+        if (targetNode.type == EdnList) {
+            if (targetNode.values.empty() || targetNode.values.front().value != ".") {
+                throw YeetCompileException(targetNode, "Expected Struct field assignment to be of form (= (. target :field) value)", filePath, __FILE__, __LINE__);
+            }
+            std::string fieldType = checkExpr(targetNode);
+            expectConvertible(valueNode, checkExpr(valueNode, fieldType), fieldType);
+            return "void";
+        }
+    }
+
+    // Literal: (= target :type value)
+    if (node.values.size() == 4) {
+        EdnNode& typeNode = *std::next(it);
+        EdnNode& valueNode = *std::next(it, 2);
+        if (typeNode.type != EdnKeyword) throw YeetCompileException(typeNode, "Expected type keyword", filePath, __FILE__, __LINE__);
+        std::string type = typeNode.value.substr(1);
+        checkKnownType(typeNode, type);
+        std::string valueType = checkExpr(valueNode, type);
+        if (isArrayType(type)) {
+            // A copy of another array of the type, or a number stored into every element
+            if (targetNode.type != EdnSymbol) throw YeetCompileException(targetNode, "Array assignment target must be a variable", filePath, __FILE__, __LINE__);
+            if (valueType != type) expectConvertible(valueNode, valueType, arrayElementType(type));
+        } else {
+            expectConvertible(valueNode, valueType, type);
+        }
+        if (targetNode.type == EdnSymbol) {
+            if (isConstant(targetNode.value)) throw YeetCompileException(targetNode, fmt::format("Cannot assign to constant {}", targetNode.value), filePath, __FILE__, __LINE__);
+            const std::string* existing = findVariable(targetNode.value);
+            if (existing && *existing != type) {
+                throw YeetCompileException(targetNode, fmt::format("Variable {} is {}, cannot assign as {}", targetNode.value, *existing, type), filePath, __FILE__, __LINE__);
+            }
+            if (!existing) scopes.back()[targetNode.value] = type;
+            targetNode.metadata["type"] = type;
+        } else if (targetNode.type == EdnList) {
+            checkExpr(targetNode);
+        } else {
+            throw YeetCompileException(targetNode, "Assignment target must be a symbol or lvalue expression (list)", filePath, __FILE__, __LINE__);
+        }
+        return type;
+    }
+    throw YeetCompileException(node, "Assignment target must be a symbol or field access", filePath, __FILE__, __LINE__);
+}
+
+// (put target :type value)
+std::string TypeChecker::checkPut(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() != 4) throw YeetCompileException(node, "put expects target, type, and value", filePath, __FILE__, __LINE__);
+    auto it = std::next(node.values.begin());
+    EdnNode& targetNode = *it;
+    EdnNode& typeNode = *std::next(it);
+    EdnNode& valueNode = *std::next(it, 2);
+    if (typeNode.type != EdnKeyword) throw YeetCompileException(typeNode, "put expects type keyword", filePath, __FILE__, __LINE__);
+    std::string type = typeNode.value.substr(1);
+    checkKnownType(typeNode, type);
+    expectConvertible(valueNode, checkExpr(valueNode, type), type);
+    if (targetNode.type == EdnSymbol) {
+        std::string targetType = checkExpr(targetNode);
+        if (!isPointerType(targetType)) {
+            throw YeetCompileException(targetNode, fmt::format("Variable {} is not a pointer type", targetNode.value), filePath, __FILE__, __LINE__);
+        }
+    } else if (targetNode.type == EdnList) {
+        checkExpr(targetNode);
+    } else {
+        throw YeetCompileException(targetNode, "put target must be a symbol or lvalue expression (list)", filePath, __FILE__, __LINE__);
+    }
+    return type;
+}
+
+// (ref x)
+std::string TypeChecker::checkReference(edn::EdnNode& node)
+{
+    if (node.values.size() != 2) throw YeetCompileException(node, "Reference operator expects one argument", filePath, __FILE__, __LINE__);
+    edn::EdnNode& targetNode = *std::next(node.values.begin());
+    if (targetNode.type != edn::EdnSymbol) throw YeetCompileException(targetNode, "Reference operator expects a symbol argument", filePath, __FILE__, __LINE__);
+    if (isConstant(targetNode.value)) throw YeetCompileException(targetNode, fmt::format("Constant {} has no address", targetNode.value), filePath, __FILE__, __LINE__);
+    return checkExpr(targetNode) + "*";
+}
+
+// (deref p)
+std::string TypeChecker::checkDereference(edn::EdnNode& node)
+{
+    if (node.values.size() != 2) throw YeetCompileException(node, "Dereference operator expects one argument", filePath, __FILE__, __LINE__);
+    edn::EdnNode& pointerNode = *std::next(node.values.begin());
+    std::string pointerType = checkExpr(pointerNode);
+    if (!isPointerType(pointerType)) {
+        throw YeetCompileException(pointerNode, "Dereference operator expects a pointer argument", filePath, __FILE__, __LINE__);
+    }
+    return pointerType.substr(0, pointerType.size() - 1);
+}
+
+// (. target :field)
+std::string TypeChecker::checkStructAccess(edn::EdnNode& node)
+{
+    if (node.values.size() != 3) throw YeetCompileException(node, "Struct field access must be of form (. target :field)", filePath, __FILE__, __LINE__);
+    auto it = std::next(node.values.begin());
+    edn::EdnNode& targetNode = *it;
+    const edn::EdnNode& fieldNode = *std::next(it);
+    if (targetNode.type != edn::EdnSymbol) throw YeetCompileException(targetNode, "Struct field access target must be a symbol", filePath, __FILE__, __LINE__);
+    if (fieldNode.type != edn::EdnKeyword) throw YeetCompileException(fieldNode, "Struct field must be a keyword", filePath, __FILE__, __LINE__);
+    std::string structName = checkExpr(targetNode);
+    auto structIt = structs.find(structName);
+    if (structIt == structs.end()) {
+        throw YeetCompileException(targetNode, fmt::format("Struct not defined: {}", structName), filePath, __FILE__, __LINE__);
+    }
+    std::string fieldName = fieldNode.value.substr(1);
+    auto fieldIt = structIt->second.fieldIndex.find(fieldName);
+    if (fieldIt != structIt->second.fieldIndex.end()) {
+        return structIt->second.fields[fieldIt->second].second;
+    }
+    throw YeetCompileException(fieldNode, fmt::format("Field not a member of struct: {} in struct {}", fieldName, structName), filePath, __FILE__, __LINE__);
+}
+
+// (struct name ((field1 :type1) (field2 :type2) ...))
+void TypeChecker::declareStruct(const edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() != 3) throw YeetCompileException(node, "struct requires a name and a field list", filePath, __FILE__, __LINE__);
+    const EdnNode& nameNode = *std::next(node.values.begin());
+    const EdnNode& fieldsNode = *std::next(node.values.begin(), 2);
+    if (nameNode.type != EdnSymbol) throw YeetCompileException(nameNode, "struct: name must be a symbol", filePath, __FILE__, __LINE__);
+    if (fieldsNode.type != EdnList) throw YeetCompileException(fieldsNode, "struct: fields must be a list", filePath, __FILE__, __LINE__);
+    if (structs.count(nameNode.value)) {
+        throw YeetCompileException(nameNode, fmt::format("Struct type already defined: {}", nameNode.value), filePath, __FILE__, __LINE__);
+    }
+    StructInfo info;
+    for (const auto& field : fieldsNode.values) {
+        if (field.type != EdnList || field.values.size() != 2 || field.values.front().type != EdnSymbol || field.values.back().type != EdnKeyword) {
+            throw YeetCompileException(field, "struct: each field must be (name :type)", filePath, __FILE__, __LINE__);
+        }
+        const std::string& fieldName = field.values.front().value;
+        std::string fieldType = field.values.back().value.substr(1);
+        checkKnownType(field.values.back(), fieldType);
+        if (isArrayType(fieldType)) {
+            throw YeetCompileException(field, fmt::format("struct: field {} cannot be an array, use a slice ({}[])", fieldName, arrayElementType(fieldType)), filePath, __FILE__, __LINE__);
+        }
+        if (!info.fieldIndex.emplace(fieldName, info.fields.size()).second) {
+            throw YeetCompileException(field, fmt::format("struct: duplicate field {}", fieldName), filePath, __FILE__, __LINE__);
+        }
+        info.fields.push_back({fieldName, fieldType});
+    }
+    structs[nameNode.value] = std::move(info);
+}
+
+// (defn :ret name (args...) body...): the signature only, the body is checked by checkDefn
+void TypeChecker::declareFunction(const edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() < 5) throw YeetCompileException(node, "defn requires a return type, name, arg list, and body", filePath, __FILE__, __LINE__);
+    auto it = std::next(node.values.begin());
+    const EdnNode& retTypeNode = *it++;
+    const EdnNode& nameNode = *it++;
+    const EdnNode& argsNode = *it++;
+    if (retTypeNode.type != EdnKeyword) throw YeetCompileException(retTypeNode, "defn: first argument must be return type keyword", filePath, __FILE__, __LINE__);
+    if (nameNode.type != EdnSymbol) throw YeetCompileException(nameNode, "defn: function name must be a symbol", filePath, __FILE__, __LINE__);
+    if (argsNode.type != EdnList) throw YeetCompileException(argsNode, "defn: argument list must be a list", filePath, __FILE__, __LINE__);
+    if (functions.count(nameNode.value)) {
+        throw YeetCompileException(nameNode, fmt::format("defn: function already defined: {}", nameNode.value), filePath, __FILE__, __LINE__);
+    }
+    Signature signature;
+    signature.returnType = retTypeNode.value.substr(1);
+    if (signature.returnType != "void") checkKnownType(retTypeNode, signature.returnType);
+    if (isArrayType(signature.returnType)) {
+        throw YeetCompileException(retTypeNode, fmt::format("defn: cannot return an array, use a slice ({}[])", arrayElementType(signature.returnType)), filePath, __FILE__, __LINE__);
+    }
+    for (const auto& arg : argsNode.values) {
+        std::string argName, argType;
+        if (arg.type == EdnList && arg.values.size() == 2 && arg.values.front().type == EdnSymbol && arg.values.back().type == EdnKeyword) {
+            argName = arg.values.front().value;
+            argType = arg.values.back().value.substr(1);
+            checkKnownType(arg.values.back(), argType);
+        } else if (arg.type == EdnSymbol) {
+            argName = arg.value;
+            argType = "int32";
+        } else {
+            throw YeetCompileException(arg, "defn: all arguments must be symbols or (name :type)", filePath, __FILE__, __LINE__);
+        }
+        if (isArrayType(argType)) {
+            throw YeetCompileException(arg, fmt::format("defn: arrays are passed as slices, declare {} as {}[]", argName, arrayElementType(argType)), filePath, __FILE__, __LINE__);
+        }
+        signature.paramNames.push_back(argName);
+        signature.params.push_back(argType);
+    }
+    functions[nameNode.value] = std::move(signature);
+}
+
+// Declared up front by declareStruct
+std::string TypeChecker::checkStruct(edn::EdnNode&)
+{
+    return "void";
+}
+
+// (defn :ret name (args...) body...), the signature was declared by declareFunction
+std::string TypeChecker::checkDefn(edn::EdnNode& node)
+{
+    using namespace edn;
+    const EdnNode& nameNode = *std::next(node.values.begin(), 2);
+    const Signature& signature = functions.at(nameNode.value);
+    // The body only sees its own arguments and locals
+    Scope bodyScope;
+    for (size_t i = 0; i < signature.params.size(); ++i) {
+        bodyScope[signature.paramNames[i]] = signature.params[i];
+    }
+    size_t callerScope = functionScope;
+    size_t callerLoopDepth = loopDepth;
+    functionScope = scopes.size();
+    loopDepth = 0;
+    scopes.push_back(std::move(bodyScope));
+    std::string resultType;
+    const EdnNode* resultNode = nullptr;
+    for (auto it = std::next(node.values.begin(), 4); it != node.values.end(); ++it) {
+        resultType = checkExpr(*it);
+        resultNode = &*it;
+    }
+    scopes.pop_back();
+    functionScope = callerScope;
+    loopDepth = callerLoopDepth;
+
+    if (signature.returnType != "void") {
+        if (resultType == "void") {
+            throw YeetCompileException(*resultNode, fmt::format("defn: body of {} does not produce a {} value", nameNode.value, signature.returnType), filePath, __FILE__, __LINE__);
+        }
+        expectConvertible(*resultNode, resultType, signature.returnType);
+    }
+    return "void";
+}
+
+// (name arg1 arg2 ...)
+std::string TypeChecker::checkCall(edn::EdnNode& node)
+{
+    const edn::EdnNode& opNode = node.values.front();
+    const Signature& signature = functions.at(opNode.value);
+    if (node.values.size() - 1 != signature.params.size()) {
+        throw YeetCompileException(node, fmt::format("Function argument count mismatch: {} expects {} arguments, got {}",
+            opNode.value, signature.params.size(), node.values.size() - 1), filePath, __FILE__, __LINE__);
+    }
+    size_t i = 0;
+    for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it, ++i) {
+        expectConvertible(*it, checkExpr(*it, signature.params[i]), signature.params[i]);
+    }
+    return signature.returnType;
+}
+
+// (cond (test1 expr1) (test2 expr2) ... (else exprN))
+std::string TypeChecker::checkCond(edn::EdnNode& node)
+{
+    if (node.values.size() < 2) throw YeetCompileException(node, "cond requires at least one clause", filePath, __FILE__, __LINE__);
+    std::string resultType;
+    for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+        edn::EdnNode& clause = *it;
+        if (clause.type != edn::EdnList || clause.values.empty() || clause.values.size() > 2) {
+            throw YeetCompileException(clause, "cond: each clause must be (test expr) or (expr)", filePath, __FILE__, __LINE__);
+        }
+        if (clause.values.size() == 2) {
+            edn::EdnNode& testNode = clause.values.front();
+            expectConvertible(testNode, checkExpr(testNode), "bool");
+        }
+        scopes.emplace_back();
+        std::string armType = checkExpr(clause.values.back());
+        scopes.pop_back();
+        // The arms meet at one type; if any arm is a statement the cond is one too
+        if (resultType.empty() || resultType == armType) {
+            resultType = armType;
+        } else if (resultType == "void" || armType == "void") {
+            resultType = "void";
+        } else if (!unifyTypes(resultType, armType, resultType)) {
+            throw YeetCompileException(clause.values.back(), fmt::format("cond: arm of type {} does not match {}", armType, resultType), filePath, __FILE__, __LINE__);
+        }
+    }
+    // Literal arms take the result type directly
+    for (auto it = std::next(node.values.begin()); it != node.values.end(); ++it) {
+        if (isLiteral(it->values.back()) && takesLiterals(resultType)) {
+            checkExpr(it->values.back(), resultType);
+        }
+    }
+    return resultType;
+}
+
+// (select test a b)
+std::string TypeChecker::checkSelect(edn::EdnNode& node)
+{
+    if (node.values.size() != 4) throw YeetCompileException(node, "select requires a test and two values", filePath, __FILE__, __LINE__);
+    edn::EdnNode& testNode = *std::next(node.values.begin());
+    edn::EdnNode& lhsNode = *std::next(node.values.begin(), 2);
+    edn::EdnNode& rhsNode = node.values.back();
+    std::string testType = checkExpr(testNode);
+    bool isMask = vectorElementType(testType) == "bool";
+    if (!isMask) expectConvertible(testNode, testType, "bool");
+    std::string lhsType = checkExpr(lhsNode);
+    std::string rhsType = checkExpr(rhsNode);
+    std::string resultType;
+    if (lhsType == "void" || rhsType == "void" || !unifyTypes(lhsType, rhsType, resultType)) {
+        throw YeetCompileException(node, fmt::format("select: values of type {} and {} have no common type", lhsType, rhsType), filePath, __FILE__, __LINE__);
+    }
+    // A mask picks lane by lane, scalar values are splat across its lanes
+    if (isMask) {
+        if (isNumericType(resultType)) resultType = fmt::format("{}x{}", resultType, vectorLanes(testType));
+        if (vectorLanes(resultType) != vectorLanes(testType)) {
+            throw YeetCompileException(node, fmt::format("select: a {} mask needs values with {} lanes, got {}", testType, vectorLanes(testType), resultType), filePath, __FILE__, __LINE__);
+        }
+    }
+    // Literal sides take the result type directly
+    for (edn::EdnNode* side : {&lhsNode, &rhsNode}) {
+        if (isLiteral(*side) && takesLiterals(resultType)) {
+            checkExpr(*side, resultType);
+        }
+    }
+    return resultType;
+}
+
+// (case expr (k1 body) ((k2 k3) body) ... (else body)): keys are distinct integer
+// literals of the subject's type. Without an else the case is a statement.
+std::string TypeChecker::checkCase(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() < 3) throw YeetCompileException(node, "case requires a value and at least one clause", filePath, __FILE__, __LINE__);
+    EdnNode& subjectNode = *std::next(node.values.begin());
+    std::string subjectType = checkExpr(subjectNode);
+    if (!isIntegerType(subjectType)) {
+        throw YeetCompileException(subjectNode, fmt::format("case: value must be an integer, got {}", subjectType), filePath, __FILE__, __LINE__);
+    }
+    std::set<long long> seen;
+    std::string resultType;
+    bool hasElse = false;
+    for (auto it = std::next(node.values.begin(), 2); it != node.values.end(); ++it) {
+        EdnNode& clause = *it;
+        if (clause.type != EdnList || clause.values.size() != 2) {
+            throw YeetCompileException(clause, "case: each clause must be (key body), ((key...) body) or (else body)", filePath, __FILE__, __LINE__);
+        }
+        EdnNode& keysNode = clause.values.front();
+        if (keysNode.type == EdnSymbol && keysNode.value == "else") {
+            if (std::next(it) != node.values.end()) throw YeetCompileException(clause, "case: else must be the last clause", filePath, __FILE__, __LINE__);
+            hasElse = true;
+        } else {
+            std::vector<EdnNode*> keys;
+            if (keysNode.type == EdnList) {
+                for (auto& key : keysNode.values) keys.push_back(&key);
+            } else {
+                keys.push_back(&keysNode);
+            }
+            if (keys.empty()) throw YeetCompileException(keysNode, "case: clause has no keys", filePath, __FILE__, __LINE__);
+            for (EdnNode* key : keys) {
+                if (key->type != EdnInt || !literalFits(key->value, subjectType)) {
+                    throw YeetCompileException(*key, fmt::format("case: key must be an integer literal that fits {}", subjectType), filePath, __FILE__, __LINE__);
+                }
+                if (!seen.insert(std::stoll(key->value)).second) {
+                    throw YeetCompileException(*key, fmt::format("case: duplicate key {}", key->value), filePath, __FILE__, __LINE__);
+                }
+                key->metadata["type"] = subjectType;
+            }
+        }
+        scopes.emplace_back();
+        std::string armType = checkExpr(clause.values.back());
+        scopes.pop_back();
+        if (resultType.empty() || resultType == armType) {
+            resultType = armType;
+        } else if (resultType == "void" || armType == "void") {
+            resultType = "void";
+        } else if (!unifyTypes(resultType, armType, resultType)) {
+            throw YeetCompileException(clause.values.back(), fmt::format("case: arm of type {} does not match {}", armType, resultType), filePath, __FILE__, __LINE__);
+        }
+    }
+    if (!hasElse) return "void";
+    // Literal arms take the result type directly
+    for (auto it = std::next(node.values.begin(), 2); it != node.values.end(); ++it) {
+        if (isLiteral(it->values.back()) && takesLiterals(resultType)) {
+            checkExpr(it->values.back(), resultType);
+        }
+    }
+    return resultType;
+}
+
+// (while test [hints...] body): a statement like for, it has no value
+std::string TypeChecker::checkWhile(edn::EdnNode& node)
+{
+    if (node.values.size() < 3) throw YeetCompileException(node, "while requires a test and a body", filePath, __FILE__, __LINE__);
+    edn::EdnNode& testNode = *std::next(node.values.begin());
+    edn::EdnNode& bodyNode = node.values.back();
+    checkLoopHints(node);
+    expectConvertible(testNode, checkExpr(testNode), "bool");
+    scopes.emplace_back();
+    ++loopDepth;
+    checkExpr(bodyNode);
+    --loopDepth;
+    scopes.pop_back();
+    return "void";
+}
+
+// (for (i start end step) [hints...] body): i is an integer of the bounds' common type,
+// bound in the body's scope. step is optional and defaults to 1. A literal step
+// fixes the direction (metadata["direction"] up or down); any other step's sign
+// is tested when the loop runs.
+std::string TypeChecker::checkFor(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() < 3) throw YeetCompileException(node, "for requires (var start end [step]) and a body", filePath, __FILE__, __LINE__);
+    EdnNode& headNode = *std::next(node.values.begin());
+    EdnNode& bodyNode = node.values.back();
+    checkLoopHints(node);
+    if (headNode.type != EdnList || headNode.values.size() < 3 || headNode.values.size() > 4 || headNode.values.front().type != EdnSymbol) {
+        throw YeetCompileException(headNode, "for: loop head must be (var start end [step])", filePath, __FILE__, __LINE__);
+    }
+    // Literal bounds take the type of the others
+    std::string varType;
+    for (auto it = std::next(headNode.values.begin()); it != headNode.values.end(); ++it) {
+        if (isLiteral(*it)) continue;
+        std::string boundType = checkExpr(*it);
+        if (!isIntegerType(boundType)) throw YeetCompileException(*it, fmt::format("for: bounds must be integers, got {}", boundType), filePath, __FILE__, __LINE__);
+        varType = varType.empty() ? boundType : commonNumericType(varType, boundType);
+    }
+    for (auto it = std::next(headNode.values.begin()); it != headNode.values.end(); ++it) {
+        if (!isLiteral(*it)) continue;
+        std::string boundType = checkExpr(*it, varType.empty() ? "int32" : varType);
+        if (!isIntegerType(boundType)) throw YeetCompileException(*it, fmt::format("for: bounds must be integers, got {}", boundType), filePath, __FILE__, __LINE__);
+        varType = varType.empty() ? boundType : commonNumericType(varType, boundType);
+    }
+    // Which way the loop runs, decided here so folding the step later cannot change it
+    node.metadata["direction"] = "up";
+    if (headNode.values.size() == 4) {
+        const EdnNode& stepNode = headNode.values.back();
+        if (stepNode.type != EdnInt) {
+            node.metadata["direction"] = "runtime";
+        } else if (std::stoll(stepNode.value) == 0) {
+            throw YeetCompileException(stepNode, "for: step must not be 0", filePath, __FILE__, __LINE__);
+        } else if (std::stoll(stepNode.value) < 0) {
+            node.metadata["direction"] = "down";
+        }
+    }
+    EdnNode& varNode = headNode.values.front();
+    varNode.metadata["type"] = varType;
+    scopes.emplace_back();
+    scopes.back()[varNode.value] = varType;
+    ++loopDepth;
+    checkExpr(bodyNode);
+    --loopDepth;
+    scopes.pop_back();
+    return "void";
+}
+
+// Loop hints between a loop's head and its body: :unroll, :vectorize and
+// :interleave, each followed by a positive count (:unroll also takes full)
+void TypeChecker::checkLoopHints(const edn::EdnNode& node)
+{
+    using namespace edn;
+    if ((node.values.size() - 3) % 2 != 0) throw YeetCompileException(node, "loop hints must be :hint value pairs", filePath, __FILE__, __LINE__);
+    for (auto it = std::next(node.values.begin(), 2); std::next(it) != node.values.end(); std::advance(it, 2)) {
+        const EdnNode& hintNode = *it;
+        const EdnNode& valueNode = *std::next(it);
+        if (hintNode.type != EdnKeyword || (hintNode.value != ":unroll" && hintNode.value != ":vectorize" && hintNode.value != ":interleave")) {
+            throw YeetCompileException(hintNode, "loop hint must be :unroll, :vectorize or :interleave", filePath, __FILE__, __LINE__);
+        }
+        if (hintNode.value == ":unroll" && valueNode.type == EdnSymbol && valueNode.value == "full") continue;
+        if (valueNode.type != EdnInt || std::stoll(valueNode.value) < 1 || !literalFits(valueNode.value, "int32")) {
+            throw YeetCompileException(valueNode, fmt::format("{} takes a positive count", hintNode.value), filePath, __FILE__, __LINE__);
+        }
+    }
+}
+
+// (break) and (continue), innermost while or for of the current function
+std::string TypeChecker::checkLoopExit(edn::EdnNode& node)
+{
+    const std::string& op = node.values.front().value;
+    if (node.values.size() != 1) throw YeetCompileException(node, fmt::format("{} takes no arguments", op), filePath, __FILE__, __LINE__);
+    if (loopDepth == 0) throw YeetCompileException(node, fmt::format("{} outside of a loop", op), filePath, __FILE__, __LINE__);
+    return "void";
+}
+
+// (op lhs rhs): operands are converted to a common type, comparisons yield bool
+std::string TypeChecker::checkBinop(edn::EdnNode& node)
+{
+    const std::string& op = node.values.front().value;
+    if (node.values.size() != 3) throw YeetCompileException(node, "Expected two operands", filePath, __FILE__, __LINE__);
+    edn::EdnNode& lhsNode = *std::next(node.values.begin());
+    edn::EdnNode& rhsNode = *std::next(node.values.begin(), 2);
+    // A literal takes the other operand's type so it needs no conversion
+    std::string lhsType, rhsType;
+    if (isLiteral(lhsNode) && !isLiteral(rhsNode)) {
+        rhsType = checkExpr(rhsNode);
+        lhsType = checkExpr(lhsNode, rhsType);
+    } else {
+        lhsType = checkExpr(lhsNode);
+        rhsType = checkExpr(rhsNode, isLiteral(rhsNode) ? lhsType : "");
+    }
+    bool isComparison = op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+    if (isVectorType(lhsType) || isVectorType(rhsType)) {
+        // Lane by lane; a scalar operand is splat across the other's lanes
+        std::string operandType;
+        if (!unifyTypes(lhsType, rhsType, operandType)) {
+            throw YeetCompileException(node, fmt::format("Operator {} expects operands of one vector type, got {} and {}", op, lhsType, rhsType), filePath, __FILE__, __LINE__);
+        }
+        std::string element = vectorElementType(operandType);
+        const std::string& scalarType = isVectorType(lhsType) ? rhsType : lhsType;
+        if (isIntegerType(element) && isFloatType(scalarType)) {
+            throw YeetCompileException(node, fmt::format("Operator {}: {} operand would be truncated to {} lanes", op, scalarType, element), filePath, __FILE__, __LINE__);
+        }
+        if (element == "bool" && op != "==" && op != "!=") {
+            throw YeetCompileException(node, fmt::format("Operator {} is not defined on masks", op), filePath, __FILE__, __LINE__);
+        }
+        node.metadata["operandType"] = operandType;
+        return isComparison ? fmt::format("boolx{}", vectorLanes(operandType)) : operandType;
+    }
+    if (!isNumericType(lhsType) || !isNumericType(rhsType)) {
+        throw YeetCompileException(node, fmt::format("Operator {} expects numeric operands, got {} and {}", op, lhsType, rhsType), filePath, __FILE__, __LINE__);
+    }
+
+    std::string operandType = commonNumericType(lhsType, rhsType);
+    if (!isComparison && operandType == "bool") {
+        operandType = "int32";
+    }
+    node.metadata["operandType"] = operandType;
+    return isComparison ? "bool" : operandType;
+}
+
+// (splat :type x): a vector with x in every lane
+std::string TypeChecker::checkSplat(edn::EdnNode& node)
+{
+    if (node.values.size() != 3) throw YeetCompileException(node, "splat requires a vector type and a value", filePath, __FILE__, __LINE__);
+    const edn::EdnNode& typeNode = *std::next(node.values.begin());
+    edn::EdnNode& valueNode = node.values.back();
+    if (typeNode.type != edn::EdnKeyword) throw YeetCompileException(typeNode, "splat expects a type keyword", filePath, __FILE__, __LINE__);
+    std::string type = typeNode.value.substr(1);
+    if (!isVectorType(type)) throw YeetCompileException(typeNode, fmt::format("splat: {} is not a vector type", type), filePath, __FILE__, __LINE__);
+    std::string element = vectorElementType(type);
+    expectConvertible(valueNode, checkExpr(valueNode, element), element);
+    return type;
+}
+
+// (extract v i): lane i of v
+std::string TypeChecker::checkExtract(edn::EdnNode& node)
+{
+    if (node.values.size() != 3) throw YeetCompileException(node, "extract requires a vector and a lane", filePath, __FILE__, __LINE__);
+    std::string vectorType = checkVector(*std::next(node.values.begin()), "extract");
+    checkLaneIndex(node.values.back(), vectorType);
+    return vectorElementType(vectorType);
+}
+
+// (insert v i x): a copy of v with lane i set to x
+std::string TypeChecker::checkInsert(edn::EdnNode& node)
+{
+    if (node.values.size() != 4) throw YeetCompileException(node, "insert requires a vector, a lane and a value", filePath, __FILE__, __LINE__);
+    std::string vectorType = checkVector(*std::next(node.values.begin()), "insert");
+    checkLaneIndex(*std::next(node.values.begin(), 2), vectorType);
+    edn::EdnNode& valueNode = node.values.back();
+    std::string element = vectorElementType(vectorType);
+    expectConvertible(valueNode, checkExpr(valueNode, element), element);
+    return vectorType;
+}
+
+// (shuffle a (i...)) or (shuffle a b (i...)): lane k of the result is lane i_k of a,
+// or of b for indices past a's lanes. The mask is a list of integer literals and
+// its length is the result's lane count.
+std::string TypeChecker::checkShuffle(edn::EdnNode& node)
+{
+    using namespace edn;
+    if (node.values.size() != 3 && node.values.size() != 4) {
+        throw YeetCompileException(node, "shuffle requires one or two vectors and a mask", filePath, __FILE__, __LINE__);
+    }
+    std::string vectorType = checkVector(*std::next(node.values.begin()), "shuffle");
+    if (node.values.size() == 4) {
+        EdnNode& otherNode = *std::next(node.values.begin(), 2);
+        std::string otherType = checkVector(otherNode, "shuffle");
+        if (otherType != vectorType) {
+            throw YeetCompileException(otherNode, fmt::format("shuffle: vectors must have one type, got {} and {}", vectorType, otherType), filePath, __FILE__, __LINE__);
+        }
+    }
+    const EdnNode& maskNode = node.values.back();
+    std::string resultType = fmt::format("{}x{}", vectorElementType(vectorType), maskNode.values.size());
+    if (maskNode.type != EdnList || !isVectorType(resultType)) {
+        throw YeetCompileException(maskNode, "shuffle: mask must be a list of 2, 4, ... 64 lane indices", filePath, __FILE__, __LINE__);
+    }
+    long long sourceLanes = static_cast<long long>(vectorLanes(vectorType)) * (node.values.size() - 2);
+    for (const auto& index : maskNode.values) {
+        if (index.type != EdnInt || !literalFits(index.value, "int32") || std::stoll(index.value) < 0 || std::stoll(index.value) >= sourceLanes) {
+            throw YeetCompileException(index, fmt::format("shuffle: lane index must be an integer literal from 0 to {}", sourceLanes - 1), filePath, __FILE__, __LINE__);
+        }
+    }
+    return resultType;
+}
+
+// (reduce op v): op folded over v's lanes. + * min max on numbers, and/or on
+// integers and masks.
+std::string TypeChecker::checkReduce(edn::EdnNode& node)
+{
+    if (node.values.size() != 3) throw YeetCompileException(node, "reduce requires an operator and a vector", filePath, __FILE__, __LINE__);
+    const edn::EdnNode& opNode = *std::next(node.values.begin());
+    std::string vectorType = checkVector(node.values.back(), "reduce");
+    std::string element = vectorElementType(vectorType);
+    const std::string& op = opNode.value;
+    bool isArithmetic = op == "+" || op == "*" || op == "min" || op == "max";
+    bool isBitwise = op == "and" || op == "or";
+    if (opNode.type != edn::EdnSymbol || (!isArithmetic && !isBitwise)) {
+        throw YeetCompileException(opNode, "reduce: operator must be +, *, min, max, and or or", filePath, __FILE__, __LINE__);
+    }
+    if ((isArithmetic && element == "bool") || (isBitwise && isFloatType(element))) {
+        throw YeetCompileException(node, fmt::format("reduce: {} is not defined on {}", op, vectorType), filePath, __FILE__, __LINE__);
+    }
+    return element;
+}
+
+// Operand of a vector builtin, its vector type
+std::string TypeChecker::checkVector(edn::EdnNode& node, const char* form)
+{
+    std::string type = checkExpr(node);
+    if (!isVectorType(type)) throw YeetCompileException(node, fmt::format("{} expects a vector, got {}", form, type), filePath, __FILE__, __LINE__);
+    return type;
+}
+
+// Lane index of extract/insert: any integer, a literal one must name a lane
+void TypeChecker::checkLaneIndex(edn::EdnNode& node, const std::string& vectorType)
+{
+    std::string indexType = checkExpr(node, "int32");
+    if (!isIntegerType(indexType)) throw YeetCompileException(node, fmt::format("Lane index must be an integer, got {}", indexType), filePath, __FILE__, __LINE__);
+    if (node.type == edn::EdnInt && (std::stoll(node.value) < 0 || std::stoll(node.value) >= vectorLanes(vectorType))) {
+        throw YeetCompileException(node, fmt::format("Lane {} out of range for {}", node.value, vectorType), filePath, __FILE__, __LINE__);
+    }
+}
+
+// (at a i): element i of an array or slice
+std::string TypeChecker::checkAt(edn::EdnNode& node)
+{
+    if (node.values.size() != 3) throw YeetCompileException(node, "at requires an array or slice and an index", filePath, __FILE__, __LINE__);
+    std::string type = checkIndexable(*std::next(node.values.begin()), "at");
+    checkIndex(node.values.back(), type);
+    return arrayElementType(type);
+}
+
+// (set-at a i v): stores v as element i, evaluates to the stored value
+std::string TypeChecker::checkSetAt(edn::EdnNode& node)
+{
+    if (node.values.size() != 4) throw YeetCompileException(node, "set-at requires an array or slice, an index and a value", filePath, __FILE__, __LINE__);
+    edn::EdnNode& targetNode = *std::next(node.values.begin());
+    if (targetNode.type == edn::EdnVector) throw YeetCompileException(targetNode, "set-at cannot store into an array literal", filePath, __FILE__, __LINE__);
+    if (targetNode.type == edn::EdnSymbol && isConstant(targetNode.value)) {
+        throw YeetCompileException(targetNode, fmt::format("set-at cannot store into constant {}", targetNode.value), filePath, __FILE__, __LINE__);
+    }
+    std::string type = checkIndexable(targetNode, "set-at");
+    checkIndex(*std::next(node.values.begin(), 2), type);
+    edn::EdnNode& valueNode = node.values.back();
+    std::string element = arrayElementType(type);
+    expectConvertible(valueNode, checkExpr(valueNode, element), element);
+    return element;
+}
+
+// (len a): number of elements, an int64
+std::string TypeChecker::checkLen(edn::EdnNode& node)
+{
+    if (node.values.size() != 2) throw YeetCompileException(node, "len requires an array or slice", filePath, __FILE__, __LINE__);
+    checkIndexable(node.values.back(), "len");
+    return "int64";
+}
+
+// (slice a start end): a view of elements start up to (not including) end
+std::string TypeChecker::checkSlice(edn::EdnNode& node)
+{
+    if (node.values.size() != 4) throw YeetCompileException(node, "slice requires an array or slice, a start and an end", filePath, __FILE__, __LINE__);
+    std::string type = checkIndexable(*std::next(node.values.begin()), "slice");
+    for (auto it = std::next(node.values.begin(), 2); it != node.values.end(); ++it) {
+        std::string boundType = checkExpr(*it, "int64");
+        if (!isIntegerType(boundType)) throw YeetCompileException(*it, fmt::format("slice: bounds must be integers, got {}", boundType), filePath, __FILE__, __LINE__);
+    }
+    return arrayElementType(type) + "[]";
+}
+
+// Operand of at/set-at/len/slice: an array variable or any slice expression
+std::string TypeChecker::checkIndexable(edn::EdnNode& node, const char* form)
+{
+    std::string type = node.type == edn::EdnSymbol ? lookupVariable(node) : node.type == edn::EdnVector ? checkArrayLiteral(node, "") : checkExpr(node);
+    if (!isArrayType(type) && !isSliceType(type)) {
+        throw YeetCompileException(node, fmt::format("{} expects an array or slice, got {}", form, type), filePath, __FILE__, __LINE__);
+    }
+    node.metadata["type"] = type;
+    return type;
+}
+
+// (def name :type value) / (const name :type value): a module-level variable
+// every defn checked after it can use, or a value fixed at compile time. Only
+// at the top level, and only numbers, vectors and arrays; a const's value must
+// fold to a constant, which codegen checks.
+std::string TypeChecker::checkDef(edn::EdnNode& node)
+{
+    using namespace edn;
+    const std::string& form = node.values.front().value;
+    if (node.values.size() != 4) throw YeetCompileException(node, fmt::format("{} expects a name, a type and a value", form), filePath, __FILE__, __LINE__);
+    EdnNode& nameNode = *std::next(node.values.begin());
+    EdnNode& typeNode = *std::next(node.values.begin(), 2);
+    EdnNode& valueNode = node.values.back();
+    if (scopes.size() != 1) throw YeetCompileException(node, fmt::format("{} is only allowed at the top level", form), filePath, __FILE__, __LINE__);
+    if (nameNode.type != EdnSymbol) throw YeetCompileException(nameNode, fmt::format("{}: name must be a symbol", form), filePath, __FILE__, __LINE__);
+    if (typeNode.type != EdnKeyword) throw YeetCompileException(typeNode, fmt::format("{}: expected type keyword", form), filePath, __FILE__, __LINE__);
+    if (findVariable(nameNode.value)) throw YeetCompileException(nameNode, fmt::format("{}: {} is already defined", form, nameNode.value), filePath, __FILE__, __LINE__);
+    std::string type = typeNode.value.substr(1);
+    checkKnownType(typeNode, type);
+    if (!isNumericType(type) && !isVectorType(type) && !isArrayType(type)) {
+        throw YeetCompileException(typeNode, fmt::format("{}: {} must be a number, vector or array type", form, type), filePath, __FILE__, __LINE__);
+    }
+    std::string valueType = checkExpr(valueNode, type);
+    if (isArrayType(type) && valueType != type) {
+        expectConvertible(valueNode, valueType, arrayElementType(type));
+    } else {
+        expectConvertible(valueNode, valueType, type);
+    }
+    globals[nameNode.value] = type;
+    if (form == "const") constants.insert(nameNode.value);
+    nameNode.metadata["type"] = type;
+    return "void";
+}
+
+// [1 2 3]: number literals of the expected array's or slice's element type, or
+// of their common type (int32 [1 2 3], float64 [1 2.5]) when nothing is expected
+std::string TypeChecker::checkArrayLiteral(edn::EdnNode& node, const std::string& expected)
+{
+    if (node.values.empty()) throw YeetCompileException(node, "Array literal needs at least one element", filePath, __FILE__, __LINE__);
+    std::string element = isArrayType(expected) || isSliceType(expected) ? arrayElementType(expected) : "";
+    if (!element.empty() && !isNumericType(element)) {
+        throw YeetCompileException(node, fmt::format("Array literal elements must be numbers, {} expects {}", expected, element), filePath, __FILE__, __LINE__);
+    }
+    for (auto& value : node.values) {
+        if (!isLiteral(value)) throw YeetCompileException(value, "Array literal elements must be number literals", filePath, __FILE__, __LINE__);
+        if (!isArrayType(expected) && !isSliceType(expected)) {
+            std::string valueType = checkExpr(value);
+            element = element.empty() ? valueType : commonNumericType(element, valueType);
+        }
+    }
+    for (auto& value : node.values) {
+        expectConvertible(value, checkExpr(value, element), element);
+    }
+    std::string type = fmt::format("{}[{}]", element, node.values.size());
+    if (isArrayType(expected) && expected != type) {
+        throw YeetCompileException(node, fmt::format("Array literal has {} elements, {} expects {}", node.values.size(), expected, arrayLength(expected)), filePath, __FILE__, __LINE__);
+    }
+    node.metadata["type"] = type;
+    return type;
+}
+
+// Any integer index; a literal one must be in range when the length is known
+void TypeChecker::checkIndex(edn::EdnNode& node, const std::string& indexableType)
+{
+    std::string indexType = checkExpr(node, "int64");
+    if (!isIntegerType(indexType)) throw YeetCompileException(node, fmt::format("Index must be an integer, got {}", indexType), filePath, __FILE__, __LINE__);
+    if (node.type != edn::EdnInt) return;
+    long long index = std::stoll(node.value);
+    uint64_t length = arrayLength(indexableType);
+    if (index < 0 || (length > 0 && static_cast<uint64_t>(index) >= length)) {
+        throw YeetCompileException(node, fmt::format("Index {} out of bounds for {}", node.value, indexableType), filePath, __FILE__, __LINE__);
+    }
+}
+
+const std::string* TypeChecker::findVariable(const std::string& name) const
+{
+    for (size_t i = scopes.size(); i-- > functionScope;) {
+        auto it = scopes[i].find(name);
+        if (it != scopes[i].end()) return &it->second;
+    }
+    auto it = globals.find(name);
+    return it != globals.end() ? &it->second : nullptr;
+}
+
+bool TypeChecker::isConstant(const std::string& name) const
+{
+    for (size_t i = scopes.size(); i-- > functionScope;) {
+        if (scopes[i].count(name)) return false;
+    }
+    return constants.count(name) > 0;
+}
+
+std::string TypeChecker::lookupVariable(const edn::EdnNode& node) const
+{
+    const std::string* type = findVariable(node.value);
+    if (!type) {
+        throw YeetCompileException(node, fmt::format("Unknown variable: {}", node.value), filePath, __FILE__, __LINE__);
+    }
+    return *type;
+}
+
+void TypeChecker::checkKnownType(const edn::EdnNode& node, const std::string& type) const
+{
+    std::string base = type;
+    while (isPointerType(base)) {
+        base.pop_back();
+    }
+    std::string element;
+    uint64_t length = 0;
+    if (splitArrayType(base, element, length)) {
+        checkKnownType(node, element);
+        if (!isNumericType(element) && !isVectorType(element) && !isPointerType(element)) {
+            throw YeetCompileException(node, fmt::format("Array elements must be numbers, vectors or pointers, got {}", element), filePath, __FILE__, __LINE__);
+        }
+        return;
+    }
+    if (!isNumericType(base) && !isVectorType(base) && !structs.count(base)) {
+        throw YeetCompileException(node, fmt::format("Unknown type: {}", type), filePath, __FILE__, __LINE__);
+    }
+}
+
+// Numbers convert implicitly between each other and into every lane of a vector,
+// pointers between each other, an array into a slice of its elements; everything
+// else must match
+void TypeChecker::expectConvertible(const edn::EdnNode& node, const std::string& from, const std::string& to) const
+{
+    if (from == to) return;
+    if (isArrayType(from) && isSliceType(to) && arrayElementType(from) == arrayElementType(to)) return;
+    if (isNumericType(from) && (isNumericType(to) || isVectorType(to))) return;
+    if (isPointerType(from) && isPointerType(to)) return;
+    throw YeetCompileException(node, fmt::format("Cannot convert {} to {}", from, to), filePath, __FILE__, __LINE__);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "edn/edn.hpp"
+
+namespace yeet
+{
+    // Type strings: int8/16/32/64, float32/64, bool, void, vectors such as int32x4,
+    // struct names, <type>* pointers, <type>[N] arrays and <type>[] slices
+    bool isIntegerType(const std::string& type);
+    bool isFloatType(const std::string& type);
+    // Integers, floats and bool, everything the implicit conversions apply to
+    bool isNumericType(const std::string& type);
+    bool isPointerType(const std::string& type);
+    unsigned integerBitWidth(const std::string& type);
+    // <element>x<lanes> SIMD vectors: int8..int64, float32/64 or bool (a mask)
+    // lanes, a power of two from 2 to 64. False for anything else.
+    bool splitVectorType(const std::string& type, std::string& element, unsigned& lanes);
+    bool isVectorType(const std::string& type);
+    std::string vectorElementType(const std::string& type);
+    unsigned vectorLanes(const std::string& type);
+    // <element>[<length>] arrays and <element>[] slices, length 0 for a slice.
+    // False for anything else.
+    bool splitArrayType(const std::string& type, std::string& element, uint64_t& length);
+    bool isArrayType(const std::string& type);
+    bool isSliceType(const std::string& type);
+    // Element type of an array or slice
+    std::string arrayElementType(const std::string& type);
+
+    // Resolved type of an expression node, set by the TypeChecker
+    const std::string& nodeType(const edn::EdnNode& node);
+
+    // Semantic analysis run over the whole tree before any IR is emitted.
+    // Every expression node gets its resolved type in metadata["type"]; binary
+    // operators also get the type their operands are converted to in
+    // metadata["operandType"], and statement sequences are marked with
+    // metadata["sequence"]. Untyped int/float literals take the type their
+    // context expects so codegen does not have to cast them.
+    class TypeChecker
+    {
+    public:
+        explicit TypeChecker(const std::string& filePath);
+
+        void check(edn::EdnNode& root);
+
+    private:
+        using Scope = std::unordered_map<std::string, std::string>;
+
+        struct StructInfo {
+            std::vector<std::pair<std::string, std::string>> fields;
+            // Field name -> position in fields
+            std::unordered_map<std::string, size_t> fieldIndex;
+        };
+
+        struct Signature {
+            std::vector<std::string> paramNames;
+            std::vector<std::string> params;
+            std::string returnType;
+        };
+
+        // Pre-pass over the whole tree, see declareGlobals in typecheck.cpp
+        void declareGlobals(const edn::EdnNode& node);
+        void declareStruct(const edn::EdnNode& node);
+        void declareFunction(const edn::EdnNode& node);
+
+        std::string checkExpr(edn::EdnNode& node, const std::string& expected = "");
+        std::string checkList(edn::EdnNode& node);
+        std::string checkAssign(edn::EdnNode& node);
+        std::string checkDef(edn::EdnNode& node);
+        std::string checkPut(edn::EdnNode& node);
+        std::string checkReference(edn::EdnNode& node);
+        std::string checkDereference(edn::EdnNode& node);
+        std::string checkStructAccess(edn::EdnNode& node);
+        std::string checkStruct(edn::EdnNode& node);
+        std::string checkDefn(edn::EdnNode& node);
+        std::string checkCall(edn::EdnNode& node);
+        std::string checkCond(edn::EdnNode& node);
+        std::string checkSelect(edn::EdnNode& node);
+        std::string checkCase(edn::EdnNode& node);
+        std::string checkWhile(edn::EdnNode& node);
+        std::string checkFor(edn::EdnNode& node);
+        std::string checkLoopExit(edn::EdnNode& node);
+        void checkLoopHints(const edn::EdnNode& node);
+        std::string checkBinop(edn::EdnNode& node);
+        std::string checkSplat(edn::EdnNode& node);
+        std::string checkExtract(edn::EdnNode& node);
+        std::string checkInsert(edn::EdnNode& node);
+        std::string checkShuffle(edn::EdnNode& node);
+        std::string checkReduce(edn::EdnNode& node);
+        std::string checkVector(edn::EdnNode& node, const char* form);
+        void checkLaneIndex(edn::EdnNode& node, const std::string& vectorType);
+        std::string checkAt(edn::EdnNode& node);
+        std::string checkSetAt(edn::EdnNode& node);
+        std::string checkLen(edn::EdnNode& node);
+        std::string checkSlice(edn::EdnNode& node);
+        std::string checkIndexable(edn::EdnNode& node, const char* form);
+        std::string checkArrayLiteral(edn::EdnNode& node, const std::string& expected);
+        void checkIndex(edn::EdnNode& node, const std::string& indexableType);
+
+        // Innermost binding in the current function, else a def/const; nullptr if there is none
+        const std::string* findVariable(const std::string& name) const;
+        std::string lookupVariable(const edn::EdnNode& node) const;
+        // Whether the name resolves to a const rather than a variable
+        bool isConstant(const std::string& name) const;
+        void checkKnownType(const edn::EdnNode& node, const std::string& type) const;
+        void expectConvertible(const edn::EdnNode& node, const std::string& from, const std::string& to) const;
+
+    private:
+        std::string filePath;
+        // Block scopes, innermost last: calc, then per defn body, while body and
+        // cond arm. Lookups stop at functionScope, the current function's body.
+        std::vector<Scope> scopes;
+        size_t functionScope = 0;
+        // Loops around the expression being checked, for break/continue
+        size_t loopDepth = 0;
+        // def and const bindings, seen from every function unless a local shadows them
+        Scope globals;
+        std::unordered_set<std::string> constants;
+        std::unordered_map<std::string, StructInfo> structs;
+        std::unordered_map<std::string, Signature> functions;
+    };
+}
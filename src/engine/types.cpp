@@ -0,0 +1,138 @@
+#include "types.hpp"
+
+using namespace yeet;
+#include <fmt/format.h>
+#include "typecheck.hpp"
+
+TypeRegistry::TypeRegistry(llvm::LLVMContext& context_, const llvm::DataLayout& dataLayout_) : context(context_), dataLayout(dataLayout_)
+{
+    auto builtin = [&](YeetType::Kind kind, const char* name, llvm::Type* llvmType, unsigned bits) {
+        auto type = std::make_unique<YeetType>();
+        type->kind = kind;
+        type->name = name;
+        type->llvmType = llvmType;
+        type->bits = bits;
+        add(std::move(type));
+    };
+    builtin(YeetType::Kind::Void, "void", llvm::Type::getVoidTy(context), 0);
+    builtin(YeetType::Kind::Bool, "bool", llvm::Type::getInt1Ty(context), 1);
+    builtin(YeetType::Kind::Integer, "int8", llvm::Type::getInt8Ty(context), 8);
+    builtin(YeetType::Kind::Integer, "int16", llvm::Type::getInt16Ty(context), 16);
+    builtin(YeetType::Kind::Integer, "int32", llvm::Type::getInt32Ty(context), 32);
+    builtin(YeetType::Kind::Integer, "int64", llvm::Type::getInt64Ty(context), 64);
+    builtin(YeetType::Kind::Float, "float32", llvm::Type::getFloatTy(context), 32);
+    builtin(YeetType::Kind::Float, "float64", llvm::Type::getDoubleTy(context), 64);
+    builtinBool = types.at("bool").get();
+    builtinFloat64 = types.at("float64").get();
+}
+
+TypeRef TypeRegistry::lookup(const std::string& name)
+{
+    auto it = types.find(name);
+    if (it != types.end()) return it->second.get();
+    // T* and vectors are interned under their full name the first time, later lookups hit above
+    if (!name.empty() && name.back() == '*') {
+        TypeRef pointee = lookup(name.substr(0, name.size() - 1));
+        return pointee ? pointerTo(pointee) : nullptr;
+    }
+    std::string element;
+    unsigned lanes = 0;
+    if (splitVectorType(name, element, lanes)) {
+        TypeRef elementType = lookup(element);
+        return elementType ? vectorOf(elementType, lanes) : nullptr;
+    }
+    uint64_t length = 0;
+    if (splitArrayType(name, element, length)) {
+        TypeRef elementType = lookup(element);
+        if (!elementType) return nullptr;
+        return length ? arrayOf(elementType, length) : sliceOf(elementType);
+    }
+    return nullptr;
+}
+
+TypeRef TypeRegistry::pointerTo(TypeRef pointee)
+{
+    std::string name = pointee->name + "*";
+    auto it = types.find(name);
+    if (it != types.end()) return it->second.get();
+    auto type = std::make_unique<YeetType>();
+    type->kind = YeetType::Kind::Pointer;
+    type->name = std::move(name);
+    // Address space 0 for default
+    type->llvmType = llvm::PointerType::get(pointee->llvmType, 0);
+    type->pointee = pointee;
+    return add(std::move(type));
+}
+
+TypeRef TypeRegistry::vectorOf(TypeRef element, unsigned lanes)
+{
+    std::string name = fmt::format("{}x{}", element->name, lanes);
+    auto it = types.find(name);
+    if (it != types.end()) return it->second.get();
+    auto type = std::make_unique<YeetType>();
+    type->kind = YeetType::Kind::Vector;
+    type->name = std::move(name);
+    type->llvmType = llvm::FixedVectorType::get(element->llvmType, lanes);
+    type->bits = element->bits;
+    type->element = element;
+    type->lanes = lanes;
+    return add(std::move(type));
+}
+
+TypeRef TypeRegistry::arrayOf(TypeRef element, uint64_t length)
+{
+    std::string name = fmt::format("{}[{}]", element->name, length);
+    auto it = types.find(name);
+    if (it != types.end()) return it->second.get();
+    auto type = std::make_unique<YeetType>();
+    type->kind = YeetType::Kind::Array;
+    type->name = std::move(name);
+    type->llvmType = llvm::ArrayType::get(element->llvmType, length);
+    type->element = element;
+    type->length = length;
+    return add(std::move(type));
+}
+
+TypeRef TypeRegistry::sliceOf(TypeRef element)
+{
+    std::string name = element->name + "[]";
+    auto it = types.find(name);
+    if (it != types.end()) return it->second.get();
+    auto type = std::make_unique<YeetType>();
+    type->kind = YeetType::Kind::Slice;
+    type->name = std::move(name);
+    type->llvmType = llvm::StructType::get(context, {llvm::PointerType::get(element->llvmType, 0), llvm::Type::getInt64Ty(context)});
+    type->element = element;
+    return add(std::move(type));
+}
+
+TypeRef TypeRegistry::defineStruct(const std::string& name, std::vector<std::pair<std::string, TypeRef>> fields)
+{
+    if (types.count(name)) return nullptr;
+    std::vector<llvm::Type*> llvmFields;
+    for (const auto& field : fields) {
+        llvmFields.push_back(field.second->llvmType);
+    }
+    auto type = std::make_unique<YeetType>();
+    type->kind = YeetType::Kind::Struct;
+    type->name = name;
+    auto structType = llvm::StructType::create(context, llvmFields, name);
+    type->llvmType = structType;
+    const llvm::StructLayout* layout = dataLayout.getStructLayout(structType);
+    for (unsigned i = 0; i < fields.size(); ++i) {
+        type->fields.push_back({std::move(fields[i].first), fields[i].second, i, layout->getElementOffset(i)});
+        type->fieldIndex.emplace(type->fields.back().name, i);
+    }
+    return add(std::move(type));
+}
+
+TypeRef TypeRegistry::add(std::unique_ptr<YeetType> type)
+{
+    if (!type->isVoid()) {
+        type->size = dataLayout.getTypeAllocSize(type->llvmType).getFixedValue();
+        type->alignment = dataLayout.getABITypeAlign(type->llvmType).value();
+    }
+    TypeRef ref = type.get();
+    types.emplace(type->name, std::move(type));
+    return ref;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/LLVMContext.h>
+
+namespace yeet
+{
+    struct YeetType;
+
+    // A struct field's position in the llvm::StructType and its byte offset from the start
+    struct StructField {
+        std::string name;
+        const YeetType* type = nullptr;
+        unsigned index = 0;
+        uint64_t offset = 0;
+    };
+
+    // A Yeet type, created once per name by the TypeRegistry. Handles are
+    // compared by address and carry everything codegen needs, so nothing past
+    // the first lookup ever looks at the type name again.
+    struct YeetType {
+        enum class Kind {
+            Void,
+            Bool,
+            Integer,
+            Float,
+            Pointer,
+            Struct,
+            Vector,
+            Array,
+            Slice
+        };
+
+        Kind kind = Kind::Void;
+        std::string name;
+        llvm::Type* llvmType = nullptr;
+        // Alloc size and ABI alignment in bytes, 0 for void
+        uint64_t size = 0;
+        uint64_t alignment = 0;
+        // Integer/float width, 1 for bool
+        unsigned bits = 0;
+        // Pointer: the type pointed to
+        const YeetType* pointee = nullptr;
+        // Vector: the lane type (a numeric builtin) and the number of lanes.
+        // Array and slice: the element type.
+        const YeetType* element = nullptr;
+        unsigned lanes = 0;
+        // Array: number of elements
+        uint64_t length = 0;
+        // Struct: layout computed once at definition, fields in declaration order
+        std::vector<StructField> fields;
+        std::unordered_map<std::string, unsigned> fieldIndex;
+
+        bool isVoid() const { return kind == Kind::Void; }
+        bool isBool() const { return kind == Kind::Bool; }
+        bool isInteger() const { return kind == Kind::Integer; }
+        bool isFloat() const { return kind == Kind::Float; }
+        bool isPointer() const { return kind == Kind::Pointer; }
+        bool isStruct() const { return kind == Kind::Struct; }
+        bool isVector() const { return kind == Kind::Vector; }
+        bool isArray() const { return kind == Kind::Array; }
+        bool isSlice() const { return kind == Kind::Slice; }
+        // Integers, floats and bool, everything the implicit conversions apply to
+        bool isNumeric() const { return isBool() || isInteger() || isFloat(); }
+
+        // nullptr when the struct has no such field
+        const StructField* field(const std::string& fieldName) const {
+            auto it = fieldIndex.find(fieldName);
+            return it == fieldIndex.end() ? nullptr : &fields[it->second];
+        }
+    };
+
+    using TypeRef = const YeetType*;
+
+    // Interned types of one module. Builtins exist up front, T*, vectors such
+    // as int32x4, arrays (T[N]) and slices (T[]) are created the first time
+    // they are asked for, structs when their definition is compiled.
+    class TypeRegistry
+    {
+    public:
+        TypeRegistry(llvm::LLVMContext& context, const llvm::DataLayout& dataLayout);
+
+        // nullptr when the name is not a builtin, a vector of one, a defined struct,
+        // or a pointer, array or slice of one of those
+        TypeRef lookup(const std::string& name);
+        TypeRef pointerTo(TypeRef pointee);
+        TypeRef vectorOf(TypeRef element, unsigned lanes);
+        // Contiguous elements on the stack
+        TypeRef arrayOf(TypeRef element, uint64_t length);
+        // { T* data, int64 length }, a view of an array or of part of one
+        TypeRef sliceOf(TypeRef element);
+        // nullptr when the name is already taken
+        TypeRef defineStruct(const std::string& name, std::vector<std::pair<std::string, TypeRef>> fields);
+
+        // Targets of the conversions codegen adds on its own: tests to bool, cond arms and calc's result to float64
+        TypeRef boolType() const { return builtinBool; }
+        TypeRef float64Type() const { return builtinFloat64; }
+
+    private:
+        TypeRef add(std::unique_ptr<YeetType> type);
+
+    private:
+        llvm::LLVMContext& context;
+        llvm::DataLayout dataLayout;
+        std::unordered_map<std::string, std::unique_ptr<YeetType>> types;
+        TypeRef builtinBool = nullptr;
+        TypeRef builtinFloat64 = nullptr;
+    };
+}
@@ -0,0 +1,96 @@
+#include "engine.hpp"
+
+using namespace yeet;
+#include <fmt/format.h>
+
+// SIMD vectors
+//
+// :int32x4, :float64x4, :boolx8 ... are llvm::FixedVectorTypes. Arithmetic and
+// comparisons on them go lane by lane through codegenBinop and a comparison
+// gives a mask (boolxN) that select takes as its test. The builtins below move
+// lanes around and fold them; each is a single IR instruction or intrinsic
+// that the backend maps to the target's SIMD instructions.
+
+// (splat :type x)
+llvm::Value* Engine::codegenSplat(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenSplat", [&] { return traceDetail(node); });
+    const edn::EdnNode& valueNode = node.values.back();
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    return convertValue(valueNode, value, typeOf(valueNode), typeOf(node), builder);
+}
+
+// (extract v i)
+llvm::Value* Engine::codegenExtract(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenExtract", [&] { return traceDetail(node); });
+    const edn::EdnNode& vectorNode = *std::next(node.values.begin());
+    llvm::Value* vector = this->codegenExpr(vectorNode, context, builder);
+    llvm::Value* lane = codegenLaneIndex(node.values.back(), typeOf(vectorNode), context, builder);
+    return builder.CreateExtractElement(vector, lane, "extract");
+}
+
+// (insert v i x)
+llvm::Value* Engine::codegenInsert(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenInsert", [&] { return traceDetail(node); });
+    const edn::EdnNode& vectorNode = *std::next(node.values.begin());
+    const edn::EdnNode& valueNode = node.values.back();
+    TypeRef vectorType = typeOf(vectorNode);
+    llvm::Value* vector = this->codegenExpr(vectorNode, context, builder);
+    llvm::Value* lane = codegenLaneIndex(*std::next(node.values.begin(), 2), vectorType, context, builder);
+    llvm::Value* value = this->codegenExpr(valueNode, context, builder);
+    value = convertValue(valueNode, value, typeOf(valueNode), vectorType->element, builder);
+    return builder.CreateInsertElement(vector, value, lane, "insert");
+}
+
+// (shuffle a (i...)) / (shuffle a b (i...)): one shufflevector with a constant mask
+llvm::Value* Engine::codegenShuffle(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenShuffle", [&] { return traceDetail(node); });
+    const edn::EdnNode& maskNode = node.values.back();
+    std::vector<int> mask;
+    for (const auto& index : maskNode.values) {
+        mask.push_back(std::stoi(index.value));
+    }
+    llvm::Value* first = this->codegenExpr(*std::next(node.values.begin()), context, builder);
+    if (node.values.size() == 3) {
+        return builder.CreateShuffleVector(first, mask, "shuffle");
+    }
+    llvm::Value* second = this->codegenExpr(*std::next(node.values.begin(), 2), context, builder);
+    return builder.CreateShuffleVector(first, second, mask, "shuffle");
+}
+
+// (reduce op v): a vector.reduce intrinsic. Float sums and products may be
+// added up in any order (reassoc), which is what lets them run as a tree of
+// vector adds instead of one lane after the other.
+llvm::Value* Engine::codegenReduce(const edn::EdnNode& node, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::TimeTraceScope timeScope("codegenReduce", [&] { return traceDetail(node); });
+    const std::string& op = std::next(node.values.begin())->value;
+    const edn::EdnNode& vectorNode = node.values.back();
+    TypeRef element = typeOf(vectorNode)->element;
+    llvm::Value* vector = this->codegenExpr(vectorNode, context, builder);
+    if (element->isFloat()) {
+        llvm::Value* result = nullptr;
+        if (op == "+") result = builder.CreateFAddReduce(llvm::ConstantFP::getNegativeZero(element->llvmType), vector);
+        else if (op == "*") result = builder.CreateFMulReduce(llvm::ConstantFP::get(element->llvmType, 1.0), vector);
+        else if (op == "min") return builder.CreateFPMinReduce(vector);
+        else if (op == "max") return builder.CreateFPMaxReduce(vector);
+        else throw YeetCompileException(node, fmt::format("reduce: {} is not defined on floats", op), filePath, __FILE__, __LINE__);
+        llvm::cast<llvm::Instruction>(result)->setHasAllowReassoc(true);
+        return result;
+    }
+    if (op == "+") return builder.CreateAddReduce(vector);
+    if (op == "*") return builder.CreateMulReduce(vector);
+    if (op == "min") return builder.CreateIntMinReduce(vector, true);
+    if (op == "max") return builder.CreateIntMaxReduce(vector, true);
+    if (op == "and") return builder.CreateAndReduce(vector);
+    if (op == "or") return builder.CreateOrReduce(vector);
+    throw YeetCompileException(node, fmt::format("Unknown reduce operator: {}", op), filePath, __FILE__, __LINE__);
+}
+
+// Lane index of extract/insert as an int32. Literals were range checked by the
+// type checker; every index, folded constants included, wraps around the lane
+// count (a power of two), so it never names a lane that is not there. For a
+// constant the mask folds away.
+llvm::Value* Engine::codegenLaneIndex(const edn::EdnNode& node, TypeRef vectorType, llvm::LLVMContext& context, llvm::IRBuilder<>& builder) {
+    llvm::Value* index = this->codegenExpr(node, context, builder);
+    index = convertValue(node, index, typeOf(node), resolveType(node, "int32"), builder);
+    return builder.CreateAnd(index, builder.getInt32(vectorType->lanes - 1), "lane");
+}
@@ -12,8 +12,27 @@
 int main(int argc, char *argv[])
 {
     cxxopts::Options options("yeet", "I'm Finna yeet");
-    options.add_options()("h,help", "Print usage")("f, filename", "The filename to execute", cxxopts::value<std::vector<std::string>>());
-    ;
+    options.add_options()
+        ("h,help", "Print usage")
+        ("f, filename", "The filename to execute", cxxopts::value<std::vector<std::string>>())
+        ("O,opt-level", "Optimization level (0-3)", cxxopts::value<unsigned>()->default_value("0"))
+        ("tiered", "Start functions at -O0 and recompile hot ones at -O3 in the background")
+        ("tier-threshold", "Calls before a function is recompiled at -O3", cxxopts::value<uint64_t>()->default_value("1000"))
+        ("profile-generate", "Instrument cond, while and defn and write the profile to this path", cxxopts::value<std::string>())
+        ("profile-use", "Optimize using branch weights and entry counts from this profile", cxxopts::value<std::string>())
+        ("march", "Instruction set to generate code for, as a CPU name (e.g. x86-64-v3, skylake-avx512); defaults to the host", cxxopts::value<std::string>())
+        ("mcpu", "CPU to tune scheduling for; defaults to the --march CPU", cxxopts::value<std::string>())
+        ("print-target", "Print the target triple, CPU and enabled features")
+        ("emit", "Artifact to write: none, ir, bc, asm or obj", cxxopts::value<std::string>()->default_value("none"))
+        ("o, output", "Output path for --emit (- for stdout)", cxxopts::value<std::string>())
+        ("multiversion", "Emit every defn once per CPU (oldest first, e.g. x86-64,x86-64-v3,x86-64-v4) behind a load time ifunc resolver", cxxopts::value<std::vector<std::string>>())
+        ("time-report", "Print how long each compile phase and optimization pass took")
+        ("trace", "Write a Chrome trace-event JSON of the compile (opens in Perfetto or chrome://tracing)", cxxopts::value<std::string>())
+        ("trace-granularity", "Drop trace events shorter than this many microseconds", cxxopts::value<unsigned>()->default_value("0"))
+        ("no-ast-opt", "Skip constant folding, dead code removal and CSE on the Yeet tree before codegen")
+        ("stats", "Print per function instruction, block, alloca, load/store, cast and call counts before and after optimization")
+        ("remarks", "Report what the loop unroller and vectorizer did with each loop and whether loop hints were honored")
+        ("unchecked", "Leave out the bounds checks on array and slice accesses");
 
     std::string engineFilePath;
 
@@ -43,7 +62,81 @@ int main(int argc, char *argv[])
                 return 1;
             }
             std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-            auto engine = std::make_unique<yeet::Engine>(engineFilePath);
+            yeet::EngineOptions engineOptions;
+            engineOptions.optLevel = result["opt-level"].as<unsigned>();
+            engineOptions.tiered = result.count("tiered") > 0;
+            engineOptions.tierThreshold = result["tier-threshold"].as<uint64_t>();
+            if (result.count("profile-generate"))
+            {
+                engineOptions.profileGenerate = result["profile-generate"].as<std::string>();
+            }
+            if (result.count("profile-use"))
+            {
+                engineOptions.profileUse = result["profile-use"].as<std::string>();
+            }
+            if (result.count("march"))
+            {
+                engineOptions.march = result["march"].as<std::string>();
+            }
+            if (result.count("mcpu"))
+            {
+                engineOptions.mcpu = result["mcpu"].as<std::string>();
+            }
+            engineOptions.printTarget = result.count("print-target") > 0;
+            std::string emit = result["emit"].as<std::string>();
+            if (emit == "none") engineOptions.emit = yeet::EmitKind::None;
+            else if (emit == "ir") engineOptions.emit = yeet::EmitKind::IR;
+            else if (emit == "bc") engineOptions.emit = yeet::EmitKind::Bitcode;
+            else if (emit == "asm") engineOptions.emit = yeet::EmitKind::Assembly;
+            else if (emit == "obj") engineOptions.emit = yeet::EmitKind::Object;
+            else
+            {
+                std::cerr << "Unknown --emit kind: " << emit << " (expected none, ir, bc, asm or obj)" << std::endl;
+                return 1;
+            }
+            if (result.count("output"))
+            {
+                engineOptions.outputPath = result["output"].as<std::string>();
+            }
+            if (result.count("multiversion"))
+            {
+                engineOptions.multiversion = result["multiversion"].as<std::vector<std::string>>();
+            }
+            engineOptions.timeReport = result.count("time-report") > 0;
+            if (result.count("trace"))
+            {
+                engineOptions.tracePath = result["trace"].as<std::string>();
+            }
+            engineOptions.traceGranularity = result["trace-granularity"].as<unsigned>();
+            engineOptions.stats = result.count("stats") > 0;
+            engineOptions.astOpt = result.count("no-ast-opt") == 0;
+            engineOptions.remarks = result.count("remarks") > 0;
+            engineOptions.boundsChecks = result.count("unchecked") == 0;
+            if (!engineOptions.multiversion.empty() && engineOptions.emit == yeet::EmitKind::None)
+            {
+                std::cerr << "--multiversion only applies to --emit artifacts." << std::endl;
+                return 1;
+            }
+            if (engineOptions.tiered && (engineOptions.emit == yeet::EmitKind::Assembly || engineOptions.emit == yeet::EmitKind::Object))
+            {
+                std::cerr << "--tiered code calls back into the engine and cannot be emitted as asm or obj." << std::endl;
+                return 1;
+            }
+            if (engineOptions.tierThreshold == 0)
+            {
+                std::cerr << "--tier-threshold must be at least 1." << std::endl;
+                return 1;
+            }
+            std::unique_ptr<yeet::Engine> engine;
+            try
+            {
+                engine = std::make_unique<yeet::Engine>(engineFilePath, engineOptions);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Failed to initialize engine: " << e.what() << std::endl;
+                return 1;
+            }
             try
             {
                 engine->run(contents);